@@ -0,0 +1,93 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+#include "../src/sockutils.h"
+
+#include <sys/socket.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using NNet::TByteReader;
+using NNet::TByteWriter;
+using NNet::TClock;
+using NNet::TEpoll;
+using NNet::TLoop;
+using NNet::TLoopMetricsSnapshot;
+using NNet::TSocket;
+using NNet::TVoidTask;
+
+// Ping-pong round trips between two loops on two threads over a socketpair, with the
+// loops blocking in epoll or busy polling for up to [budget_us] before blocking. Wants two
+// free cores: a spinning loop on a shared core only takes time from its peer.
+//   busypoll [round trips] [budget_us] [pause_us]
+
+namespace {
+
+TVoidTask server(TLoop<TEpoll>* loop, TSocket* socket, size_t count) {
+    char byte;
+    for (size_t i = 0; i < count; ++i) {
+        co_await TByteReader<TSocket>(*socket).Read(&byte, 1);
+        co_await TByteWriter<TSocket>(*socket).Write(&byte, 1);
+    }
+    loop->Stop();
+}
+
+TVoidTask client(TLoop<TEpoll>* loop, TSocket* socket, size_t count,
+                 std::chrono::microseconds pause, std::vector<TClock::duration>* rtts) {
+    char byte = 'x';
+    for (size_t i = 0; i < count; ++i) {
+        auto start = TClock::now();
+        co_await TByteWriter<TSocket>(*socket).Write(&byte, 1);
+        co_await TByteReader<TSocket>(*socket).Read(&byte, 1);
+        rtts->push_back(TClock::now() - start);
+        if (pause.count()) {
+            co_await loop->Poller().Sleep(pause);  // idle gaps, the adaptive budget follows
+        }
+    }
+    loop->Stop();
+}
+
+void Report(const char* name, const TLoopMetricsSnapshot& m) {
+    std::cout << name << ": spin " << m.SpinNs / 1000000 << "ms (" << m.SpinHits << " hits, "
+              << m.SpinMisses << " misses), work " << m.StepNs.Sum / 1000000 << "ms\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 100000;
+    auto budget = std::chrono::microseconds(argc > 2 ? std::atoll(argv[2]) : 50);
+    auto pause = std::chrono::microseconds(argc > 3 ? std::atoll(argv[3]) : 0);
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return 1;
+    }
+    TLoop<TEpoll> serverLoop;
+    TLoop<TEpoll> clientLoop;
+    serverLoop.SetBusyPoll(budget);
+    clientLoop.SetBusyPoll(budget);
+    TSocket serverSocket(fds[1], serverLoop.Poller());
+    TSocket clientSocket(fds[0], clientLoop.Poller());
+    std::vector<TClock::duration> rtts;
+    rtts.reserve(count);
+
+    server(&serverLoop, &serverSocket, count);
+    std::thread thread([&] { serverLoop.Loop(); });
+    client(&clientLoop, &clientSocket, count, pause, &rtts);
+    clientLoop.Loop();
+    thread.join();
+
+    std::sort(rtts.begin(), rtts.end());
+    auto us = [&](double q) {
+        return std::chrono::duration<double, std::micro>(rtts[(rtts.size() - 1) * q]).count();
+    };
+    std::cout << "budget " << budget.count() << "us: rtt p50 " << us(0.5) << "us, p99 "
+              << us(0.99) << "us, max " << us(1) << "us\n";
+    Report("client", clientLoop.Poller().Metrics().Snapshot());
+    Report("server", serverLoop.Poller().Metrics().Snapshot());
+    return 0;
+}
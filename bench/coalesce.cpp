@@ -0,0 +1,79 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+#include "../src/sockutils.h"
+
+#include <sys/socket.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using NNet::TBufferedWriter;
+using NNet::TByteReader;
+using NNet::TByteWriter;
+using NNet::TClock;
+using NNet::TEpoll;
+using NNet::TLoop;
+using NNet::TSocket;
+using NNet::TVoidTask;
+
+// Pipelined small replies over a socketpair: the server answers every request with a
+// reply per TByteWriter::Write() or coalesces them with TBufferedWriter, the client sends
+// a batch of requests and waits for all the replies.
+//   coalesce [requests] [direct|buffered] [batch]
+
+namespace {
+
+constexpr size_t message_size = 32;
+
+TVoidTask server(TSocket* socket, bool buffered, size_t count) {
+    char request[message_size];
+    TByteReader<TSocket> reader(*socket);
+    TByteWriter<TSocket> direct(*socket);
+    TBufferedWriter<TSocket> writer(*socket);
+    for (size_t i = 0; i < count; ++i) {
+        co_await reader.Read(request, sizeof(request));
+        if (buffered) {
+            co_await writer.Write(request, sizeof(request));
+        } else {
+            co_await direct.Write(request, sizeof(request));
+        }
+    }
+    co_await writer.Flush();
+}
+
+TVoidTask client(TLoop<TEpoll>* loop, TSocket* socket, std::string mode, size_t count,
+                 size_t batch) {
+    std::string requests(message_size * batch, 'x');
+    std::string replies(requests.size(), 0);
+    auto start = TClock::now();
+    for (size_t i = 0; i < count; i += batch) {
+        co_await TByteWriter<TSocket>(*socket).Write(requests.data(), requests.size());
+        co_await TByteReader<TSocket>(*socket).Read(replies.data(), replies.size());
+    }
+    auto seconds = std::chrono::duration<double>(TClock::now() - start).count();
+    auto metrics = loop->Poller().Metrics().Snapshot();
+    std::cout << mode << ": " << static_cast<size_t>(count / seconds) << " replies/s, "
+              << static_cast<double>(metrics.WriteCalls) / count << " writes per reply\n";
+    loop->Stop();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    std::string mode = argc > 2 ? argv[2] : "buffered";
+    size_t batch = argc > 3 ? std::atoll(argv[3]) : 16;
+    count -= count % batch;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return 1;
+    }
+    TLoop<TEpoll> loop;
+    TSocket clientSocket(fds[0], loop.Poller());
+    TSocket serverSocket(fds[1], loop.Poller());
+    server(&serverSocket, mode == "buffered", count);
+    client(&loop, &clientSocket, mode, count, batch);
+    loop.Loop();
+    return 0;
+}
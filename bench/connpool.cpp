@@ -0,0 +1,85 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+#include "../src/sockutils.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using NNet::TAddress;
+using NNet::TByteReader;
+using NNet::TByteWriter;
+using NNet::TClock;
+using NNet::TConnectionPool;
+using NNet::TEpoll;
+using NNet::TLoop;
+using NNet::TSocket;
+using NNet::TVoidTask;
+
+// Request/reply calls to a loopback TCP server, each on a fresh connection (connect,
+// call, close) or on a connection taken from TConnectionPool.
+//   connpool [calls] [fresh|pooled] [port]
+
+namespace {
+
+TVoidTask serve(TSocket socket) {
+    char byte;
+    try {
+        while (true) {
+            co_await TByteReader<TSocket>(socket).Read(&byte, 1);
+            co_await TByteWriter<TSocket>(socket).Write(&byte, 1);
+        }
+    } catch (const std::exception&) {
+        // the client has closed the connection
+    }
+    socket.Close();
+}
+
+TVoidTask server(TSocket* listener) {
+    while (true) {
+        serve(co_await listener->Accept());
+    }
+}
+
+TVoidTask client(TLoop<TEpoll>* loop, TAddress addr, size_t count, bool pooled) {
+    TConnectionPool<TSocket> pool(loop->Poller());
+    char byte = 'x';
+    auto start = TClock::now();
+    for (size_t i = 0; i < count; ++i) {
+        if (pooled) {
+            auto conn = co_await pool.Acquire(addr);
+            co_await TByteWriter<TSocket>(conn.Socket()).Write(&byte, 1);
+            co_await TByteReader<TSocket>(conn.Socket()).Read(&byte, 1);
+            conn.Release();
+        } else {
+            TSocket socket(loop->Poller(), addr.Domain());
+            co_await socket.Connect(addr);
+            co_await TByteWriter<TSocket>(socket).Write(&byte, 1);
+            co_await TByteReader<TSocket>(socket).Read(&byte, 1);
+            socket.Close();
+        }
+    }
+    auto seconds = std::chrono::duration<double>(TClock::now() - start).count();
+    auto stats = pool.Stats();
+    std::cout << (pooled ? "pooled" : "fresh") << ": " << static_cast<size_t>(count / seconds)
+              << " calls/s, " << (pooled ? stats.Connected : count) << " connections\n";
+    loop->Stop();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 20000;
+    bool pooled = argc > 2 ? std::string(argv[2]) == "pooled" : true;
+    int port = argc > 3 ? std::atoi(argv[3]) : 18890;
+
+    TLoop<TEpoll> loop;
+    TAddress addr{"127.0.0.1", port};
+    TSocket listener(loop.Poller(), addr.Domain());
+    listener.Bind(addr);
+    listener.Listen(1024);
+    server(&listener);
+    client(&loop, addr, count, pooled);
+    loop.Loop();
+    return 0;
+}
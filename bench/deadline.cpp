@@ -0,0 +1,69 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+#include "../src/sockutils.h"
+
+#include <sys/socket.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using NNet::TByteReader;
+using NNet::TByteWriter;
+using NNet::TClock;
+using NNet::TEpoll;
+using NNet::TLoop;
+using NNet::TSocket;
+using NNet::TTime;
+using NNet::TValueTask;
+using NNet::TVoidTask;
+
+// Request/response over a socketpair, the server waits for every request, with and
+// without a per-request deadline: the cost of arming and cancelling the timer.
+//   deadline [requests]
+
+namespace {
+
+constexpr size_t message_size = 64;
+
+TVoidTask server(TSocket* socket, bool deadline, size_t count) {
+    char request[message_size];
+    for (size_t i = 0; i < count; ++i) {
+        auto until = deadline ? TClock::now() + std::chrono::seconds(10) : TTime::max();
+        co_await TByteReader<TSocket>(*socket).Read(request, sizeof(request), until);
+        co_await TByteWriter<TSocket>(*socket).Write(request, sizeof(request), until);
+    }
+}
+
+TVoidTask client(TLoop<TEpoll>* loop, TSocket* socket, bool deadline, size_t count) {
+    char message[message_size] = "ping";
+    auto start = TClock::now();
+    for (size_t i = 0; i < count; ++i) {
+        co_await TByteWriter<TSocket>(*socket).Write(message, sizeof(message));
+        co_await TByteReader<TSocket>(*socket).Read(message, sizeof(message));
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(TClock::now() - start).count();
+    std::cout << "deadline " << (deadline ? "on: " : "off: ") << ns / count << " ns/request, "
+              << loop->Poller().TimersSize() << " timers left\n";
+    loop->Stop();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 200000;
+    for (bool deadline : {false, true}) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            return 1;
+        }
+        TLoop<TEpoll> loop;
+        TSocket clientSocket(fds[0], loop.Poller());
+        TSocket serverSocket(fds[1], loop.Poller());
+        server(&serverSocket, deadline, count);
+        client(&loop, &clientSocket, deadline, count);
+        loop.Loop();
+        clientSocket.Close();
+        serverSocket.Close();
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+#include "../src/sockutils.h"
+
+#include <sys/socket.h>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+using NNet::TByteReader;
+using NNet::TByteWriter;
+using NNet::TClock;
+using NNet::TEpoll;
+using NNet::TFramePool;
+using NNet::TLoop;
+using NNet::TSocket;
+using NNet::TValueTask;
+using NNet::TVoidTask;
+
+// Request/response over a socketpair: a handler coroutine per request reads the request
+// and writes the response through TByteReader/TByteWriter. Reports malloc calls per
+// request with the frame pool on and off.
+//   frames [requests]
+
+namespace {
+
+size_t mallocs = 0;
+
+constexpr size_t message_size = 64;
+
+TVoidTask handler(TSocket* socket) {
+    char request[message_size];
+    co_await TByteReader<TSocket>(*socket).Read(request, sizeof(request));
+    co_await TByteWriter<TSocket>(*socket).Write(request, sizeof(request));
+}
+
+TValueTask<void> request(TSocket* client, TSocket* server) {
+    char message[message_size] = "ping";
+    handler(server);
+    co_await TByteWriter<TSocket>(*client).Write(message, sizeof(message));
+    co_await TByteReader<TSocket>(*client).Read(message, sizeof(message));
+}
+
+TVoidTask run(TLoop<TEpoll>* loop, TSocket* client, TSocket* server, size_t count, bool pool) {
+    TFramePool::SetEnabled(pool);
+    for (size_t i = 0; i < 1000; ++i) {
+        co_await request(client, server);  // warm up
+    }
+    size_t before = mallocs;
+    auto start = TClock::now();
+    for (size_t i = 0; i < count; ++i) {
+        co_await request(client, server);
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(TClock::now() - start).count();
+    std::cout << "pool " << (pool ? "on: " : "off: ")
+              << static_cast<double>(mallocs - before) / count << " mallocs/request, "
+              << ns / count << " ns/request\n";
+    loop->Stop();
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    ++mallocs;
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 100000;
+    for (bool pool : {false, true}) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            return 1;
+        }
+        TLoop<TEpoll> loop;
+        TSocket client(fds[0], loop.Poller());
+        TSocket server(fds[1], loop.Poller());
+        run(&loop, &client, &server, count, pool);
+        loop.Loop();
+        client.Close();
+        server.Close();
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "../src/all.h"
+#include "../src/framing.h"
+#include "../src/promises.h"
+#include "../src/sockutils.h"
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using NNet::EFramePrefix;
+using NNet::TByteReader;
+using NNet::TClock;
+using NNet::TEpoll;
+using NNet::TFrame;
+using NNet::TFrameReader;
+using NNet::TFrameWriter;
+using NNet::TLoop;
+using NNet::TSocket;
+using NNet::TVoidTask;
+
+// Length-prefixed frames over a socketpair, 32 frames per writev. The reader hand-rolls
+// two awaited reads per frame (fixed prefix only), takes a frame per Read() or every
+// complete frame per ReadFrames(). Payloads are checked.
+//   framing [frames] [manual|read|batch] [fixed|varint] [payload size]
+
+namespace {
+
+constexpr size_t frames_per_write = 32;
+
+struct TResult {
+    size_t Frames = 0;
+    size_t Errors = 0;
+};
+
+void check(const TFrame& frame, size_t index, TResult* result) {
+    char expected = static_cast<char>(index);
+    for (auto part : {frame.Part1, frame.Part2}) {
+        for (char c : part) {
+            result->Errors += c != expected;
+        }
+    }
+    ++result->Frames;
+}
+
+TVoidTask reader(TLoop<TEpoll>* loop, TSocket* socket, std::string mode, EFramePrefix prefix,
+                 size_t count, TResult* result) {
+    if (mode == "manual") {
+        TByteReader<TSocket> byteReader(*socket);
+        std::string payload;
+        while (result->Frames < count) {
+            uint32_t size;
+            co_await byteReader.Read(&size, sizeof(size));
+            payload.resize(ntohl(size));
+            co_await byteReader.Read(payload.data(), payload.size());
+            check({payload, {}}, result->Frames, result);
+        }
+    } else {
+        TFrameReader<TSocket> frameReader(*socket, prefix);
+        while (result->Frames < count) {
+            if (mode == "batch") {
+                for (auto& frame : co_await frameReader.ReadFrames()) {
+                    check(frame, result->Frames, result);
+                }
+            } else {
+                auto frame = co_await frameReader.Read();
+                check(*frame, result->Frames, result);
+            }
+        }
+    }
+    loop->Stop();
+}
+
+TVoidTask writer(TSocket* socket, EFramePrefix prefix, size_t count, size_t payloadSize) {
+    std::vector<std::string> payloads;
+    for (size_t i = 0; i < 256; ++i) {
+        payloads.emplace_back(payloadSize, static_cast<char>(i));
+    }
+    TFrameWriter<TSocket> frameWriter(*socket, prefix);
+    for (size_t i = 0; i < count; ++i) {
+        auto& payload = payloads[i % payloads.size()];
+        frameWriter.Add(payload.data(), payload.size());
+        if ((i + 1) % frames_per_write == 0 || i + 1 == count) {
+            co_await frameWriter.Flush();
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    std::string mode = argc > 2 ? argv[2] : "batch";
+    auto prefix = argc > 3 && std::string(argv[3]) == "varint" ? EFramePrefix::Varint
+                                                              : EFramePrefix::Fixed32;
+    size_t payloadSize = argc > 4 ? std::atoll(argv[4]) : 100;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return 1;
+    }
+    TLoop<TEpoll> loop;
+    TSocket in(fds[0], loop.Poller());
+    TSocket out(fds[1], loop.Poller());
+    TResult result;
+    auto start = TClock::now();
+    reader(&loop, &in, mode, prefix, count, &result);
+    writer(&out, prefix, count, payloadSize);
+    loop.Loop();
+    auto seconds = std::chrono::duration<double>(TClock::now() - start).count();
+    std::cout << mode << ": " << static_cast<size_t>(result.Frames / seconds) << " frames/s, "
+              << result.Errors << " corrupted bytes\n";
+    return result.Errors != 0;
+}
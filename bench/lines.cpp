@@ -0,0 +1,111 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+#include "../src/sockutils.h"
+
+#include <sys/socket.h>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using NNet::TBufferPoolStats;
+using NNet::TByteWriter;
+using NNet::TClock;
+using NNet::TEpoll;
+using NNet::TLineReader;
+using NNet::TLoop;
+using NNet::TSocket;
+using NNet::TVoidTask;
+
+// Line reading over many socketpairs: memory held by the readers while the connections
+// are idle and while every connection has a partial line pending, then lines per second
+// with a Read() per line or a ReadLines() per read, 16 lines arrive per write.
+//   lines [connections] [rounds] [read|batch]
+
+namespace {
+
+constexpr int max_line_size = 4096;  // a splitter of its own would hold 8KB
+constexpr size_t lines_per_write = 16;
+
+TVoidTask reader(TSocket* socket, bool batch, size_t* lines) {
+    TLineReader<TSocket> lineReader(*socket, max_line_size);
+    if (batch) {
+        while (true) {
+            auto batchLines = co_await lineReader.ReadLines();
+            if (batchLines.empty()) {
+                break;
+            }
+            *lines += batchLines.size();
+        }
+    } else {
+        while (co_await lineReader.Read()) {
+            ++*lines;
+        }
+    }
+}
+
+void report(const char* stage, TBufferPoolStats stats, size_t connections) {
+    std::cout << stage << ": " << stats.InUse << " buffers in use, " << stats.MappedBytes / 1024
+              << "KB mapped, " << stats.InUse * max_line_size * 2 / connections
+              << " bytes/connection (" << max_line_size * 2 << " without the pool)\n";
+}
+
+TVoidTask run(TLoop<TEpoll>* loop, std::vector<std::unique_ptr<TSocket>>* writers,
+              size_t rounds, size_t* lines) {
+    auto& pool = loop->Poller().BufferPool();
+    size_t connections = writers->size();
+    co_await loop->Poller().Yield();
+    report("idle", pool.Stats(), connections);
+
+    for (auto& writer : *writers) {
+        co_await TByteWriter<TSocket>(*writer).Write("partial", 7);
+    }
+    co_await loop->Poller().Sleep(std::chrono::milliseconds(10));
+    report("partial lines", pool.Stats(), connections);
+
+    std::string line;
+    for (size_t i = 0; i < lines_per_write; ++i) {
+        line += "ping\n";
+    }
+    auto start = TClock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        for (auto& writer : *writers) {
+            co_await TByteWriter<TSocket>(*writer).Write(line.data(), line.size());
+        }
+        co_await loop->Poller().Yield();
+    }
+    co_await loop->Poller().Sleep(std::chrono::milliseconds(10));
+    auto seconds = std::chrono::duration<double>(TClock::now() - start).count();
+    report("idle again", pool.Stats(), connections);
+    auto stats = pool.Stats();
+    std::cout << static_cast<size_t>(*lines / seconds) << " lines/s, peak " << stats.PeakInUse
+              << " buffers, " << stats.Overflows << " overflows\n";
+    loop->Stop();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t connections = argc > 1 ? std::atoll(argv[1]) : 1000;
+    size_t rounds = argc > 2 ? std::atoll(argv[2]) : 100;
+    bool batch = argc > 3 && std::string(argv[3]) == "batch";
+
+    TLoop<TEpoll> loop;
+    std::vector<std::unique_ptr<TSocket>> readers;
+    std::vector<std::unique_ptr<TSocket>> writers;
+    size_t lines = 0;
+    for (size_t i = 0; i < connections; ++i) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            std::cerr << "socketpair failed\n";
+            return 1;
+        }
+        readers.emplace_back(std::make_unique<TSocket>(fds[0], loop.Poller()));
+        writers.emplace_back(std::make_unique<TSocket>(fds[1], loop.Poller()));
+        reader(readers.back().get(), batch, &lines);
+    }
+    run(&loop, &writers, rounds, &lines);
+    loop.Loop();
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+#include "../src/scan.h"
+#include "../src/sockutils.h"
+
+#include <benchmark/benchmark.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <coroutine>
+#include <string>
+#include <vector>
+
+using NNet::All;
+using NNet::Any;
+using NNet::TAddress;
+using NNet::TClock;
+using NNet::TEpoll;
+using NNet::TFuture;
+using NNet::TLineSplitter;
+using NNet::TValueTask;
+using NNet::TVoidSuspendedTask;
+using NNet::TVoidTask;
+using NNet::TZeroCopyLineSplitter;
+
+// Micro-benchmarks of the building blocks, on Google Benchmark. Machine-readable output
+// for tracking regressions:
+//   micro --benchmark_format=json > results.json
+//   micro --benchmark_out=results.csv --benchmark_out_format=csv
+//   micro --benchmark_filter=Timer
+
+namespace {
+
+// a coroutine that can be resumed any number of times: stands for the waiting coroutines
+TVoidSuspendedTask Parked() {
+    while (true) {
+        co_await std::suspend_always{};
+    }
+}
+
+struct TParked {
+    TParked() : Handle(Parked()) {}
+    ~TParked() { Handle.destroy(); }
+
+    TVoidSuspendedTask Handle;
+};
+
+void BM_TimerAddProcess(benchmark::State& state) {
+    TEpoll poller;
+    TParked parked;
+    auto count = state.range(0);
+    for (auto _ : state) {
+        auto now = TClock::now();
+        for (int64_t i = 0; i < count; ++i) {
+            poller.AddTimer(now, parked.Handle);
+        }
+        poller.ProcessTimers();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_TimerAddProcess)->Arg(1)->Arg(64)->Arg(1024);
+
+void BM_TimerAddRemove(benchmark::State& state) {
+    TEpoll poller;
+    TParked parked;
+    auto deadline = TClock::now() + std::chrono::seconds(60);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(poller.RemoveTimer(poller.AddTimer(deadline, parked.Handle)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimerAddRemove);
+
+// one Poll() + wakeup round with N readable sockets, every waiter re-arms its read like a
+// coroutine looping on ReadSome (level-triggered: an edge would only fire once here)
+void BM_EpollPollReady(benchmark::State& state) {
+    auto count = state.range(0);
+    TEpoll poller;
+    TParked parked;
+    std::vector<int> fds;
+    for (int64_t i = 0; i < count; ++i) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+            state.SkipWithError("socketpair failed");
+            break;
+        }
+        if (write(pair[1], "x", 1) != 1) {
+            state.SkipWithError("write failed");
+            break;
+        }
+        fds.push_back(pair[0]);
+        fds.push_back(pair[1]);
+    }
+    for (auto _ : state) {
+        for (size_t i = 0; i < fds.size(); i += 2) {
+            poller.AddRead(fds[i], parked.Handle);
+        }
+        poller.Poll();
+        poller.WakeupReadyHandles();
+    }
+    for (int fd : fds) {
+        poller.RemoveEvent(fd);
+        close(fd);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_EpollPollReady)->Arg(1)->Arg(64)->Arg(1024)->ArgName("fds");
+
+std::string MakeLines(size_t lineLength, size_t size) {
+    std::string chunk;
+    while (chunk.size() + lineLength <= size) {
+        chunk.append(lineLength - 1, 'x');
+        chunk += '\n';
+    }
+    return chunk;
+}
+
+template <typename TSplitter>
+void BM_Splitter(benchmark::State& state) {
+    auto chunk = MakeLines(state.range(0), 4096);
+    TSplitter splitter(4096);
+    size_t lines = 0;
+    for (auto _ : state) {
+        splitter.Push(chunk.data(), chunk.size());
+        while (auto line = splitter.Pop()) {
+            benchmark::DoNotOptimize(line);
+            ++lines;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * chunk.size());
+    state.SetItemsProcessed(lines);
+}
+BENCHMARK(BM_Splitter<TLineSplitter>)->Arg(16)->Arg(64)->Arg(512);
+BENCHMARK(BM_Splitter<TZeroCopyLineSplitter>)->Arg(16)->Arg(64)->Arg(512);
+
+void BM_ScanDelimiters(benchmark::State& state) {
+    auto chunk = MakeLines(state.range(0), 4096);
+    std::vector<size_t> positions;
+    for (auto _ : state) {
+        positions.clear();
+        NNet::ScanDelimiters(chunk.data(), chunk.size(), '\n', 0, positions);
+        benchmark::DoNotOptimize(positions.data());
+    }
+    state.SetBytesProcessed(state.iterations() * chunk.size());
+}
+BENCHMARK(BM_ScanDelimiters)->Arg(16)->Arg(64)->Arg(512);
+
+TValueTask<int> Chain(int depth) {
+    if (depth == 0) {
+        co_return 0;
+    }
+    co_return co_await Chain(depth - 1) + 1;
+}
+
+TVoidTask Drive(TValueTask<int> task, int* result) { *result = co_await task; }
+
+// creation and await of a chain of TValueTask, every link completes synchronously
+void BM_ValueTaskChain(benchmark::State& state) {
+    int result = 0;
+    for (auto _ : state) {
+        Drive(Chain(state.range(0)), &result);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations() * (state.range(0) + 1));
+}
+BENCHMARK(BM_ValueTaskChain)->Arg(0)->Arg(1)->Arg(10);
+
+TValueTask<int> Ready(int value) { co_return value; }
+
+TVoidTask DriveAll(std::vector<TFuture<int>> futures, size_t* result) {
+    *result = (co_await All(std::move(futures))).size();
+}
+
+TVoidTask DriveAny(std::vector<TFuture<int>> futures, size_t* result) {
+    *result = co_await Any(std::move(futures));
+}
+
+template <bool any>
+void BM_Combinator(benchmark::State& state) {
+    size_t result = 0;
+    for (auto _ : state) {
+        std::vector<TFuture<int>> futures;
+        futures.reserve(state.range(0));
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            futures.emplace_back(Ready(i));
+        }
+        if constexpr (any) {
+            DriveAny(std::move(futures), &result);
+        } else {
+            DriveAll(std::move(futures), &result);
+        }
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Combinator<false>)->Name("BM_All")->Arg(1)->Arg(16)->Arg(256);
+BENCHMARK(BM_Combinator<true>)->Name("BM_Any")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_AddressParse(benchmark::State& state) {
+    std::string host = state.range(0) ? "2001:db8::1:0:0:1" : "192.168.100.200";
+    for (auto _ : state) {
+        TAddress addr{host, 8080};
+        benchmark::DoNotOptimize(addr);
+    }
+}
+BENCHMARK(BM_AddressParse)->Arg(0)->Arg(1)->ArgName("ipv6");
+
+void BM_AddressFormat(benchmark::State& state) {
+    TAddress addr{state.range(0) ? "2001:db8::1:0:0:1" : "192.168.100.200", 8080};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(addr.ToString());
+    }
+}
+BENCHMARK(BM_AddressFormat)->Arg(0)->Arg(1)->ArgName("ipv6");
+
+// lookup of the connection pool: hash and comparison of the key
+void BM_AddressHash(benchmark::State& state) {
+    TAddress addr{state.range(0) ? "2001:db8::1:0:0:1" : "192.168.100.200", 8080};
+    TAddress other = addr;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(std::hash<TAddress>{}(addr));
+        benchmark::DoNotOptimize(addr == other);
+    }
+}
+BENCHMARK(BM_AddressHash)->Arg(0)->Arg(1)->ArgName("ipv6");
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,371 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+#include "../src/sockutils.h"
+
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using NNet::TAddress;
+using NNet::TByteReader;
+using NNet::TByteWriter;
+using NNet::TClock;
+using NNet::TDatagramSocket;
+using NNet::TEpoll;
+using NNet::TFuture;
+using NNet::TLoop;
+using NNet::TResolver;
+using NNet::TSocket;
+using NNet::TTimeoutError;
+using NNet::TVoidTask;
+
+// TResolver against a stub nameserver on 127.0.0.1 (UDP and TCP) in the same loop, behind a
+// nameserver that refuses: replies with another id or question dropped, compression
+// pointers, CNAME chains, truncation and the TCP retry, negative TTLs of SOA records, the
+// TTL cache and its expiry, coalesced lookups, server errors and timeouts. The exit code is
+// 1 if a check fails. Then cached lookups per second.
+//   resolver [cached lookups] [port]
+
+namespace {
+
+constexpr uint16_t TypeA = 1;
+constexpr uint16_t TypeCname = 5;
+constexpr uint16_t TypeSoa = 6;
+constexpr uint16_t TypeAaaa = 28;
+
+struct TQuery {
+    uint16_t Id;
+    std::string Name;
+    uint16_t Type;
+    std::string Question;  // as sent: name, type and class
+};
+
+std::string Encode(const std::string& name) {
+    std::string out;
+    size_t start = 0;
+    while (start < name.size()) {
+        auto end = std::min(name.find('.', start), name.size());
+        out.push_back(char(end - start));
+        out.append(name, start, end - start);
+        start = end + 1;
+    }
+    out.push_back(0);
+    return out;
+}
+
+std::string U16(uint16_t v) {
+    return {char(v >> 8), char(v & 0xFF)};
+}
+
+std::string U32(uint32_t v) {
+    return U16(v >> 16) + U16(v & 0xFFFF);
+}
+
+std::string Pointer(size_t offset) {
+    return U16(0xC000 | offset);
+}
+
+std::optional<TQuery> ParseQuery(std::string_view msg) {
+    if (msg.size() < 17) {
+        return std::nullopt;
+    }
+    TQuery query;
+    query.Id = uint8_t(msg[0]) << 8 | uint8_t(msg[1]);
+    size_t pos = 12;
+    while (pos < msg.size() && msg[pos]) {
+        size_t len = uint8_t(msg[pos]);
+        if (!query.Name.empty()) {
+            query.Name.push_back('.');
+        }
+        query.Name.append(msg.substr(pos + 1, len));
+        pos += 1 + len;
+    }
+    if (pos + 5 > msg.size()) {
+        return std::nullopt;
+    }
+    query.Type = uint8_t(msg[pos + 1]) << 8 | uint8_t(msg[pos + 2]);
+    query.Question = msg.substr(12, pos + 5 - 12);
+    return query;
+}
+
+// a reply to one question, records owned by the question name use a pointer to it
+class TReplyBuilder {
+ public:
+    TReplyBuilder(const TQuery& query, int rcode = 0, bool truncated = false)
+        : Data(U16(query.Id) + U16(0x8180 | rcode | (truncated ? 0x0200 : 0)) + U16(1) +
+               U16(0) + U16(0) + U16(0) + query.Question),
+          Suffix(12 + 1 + query.Name.find('.')) {}
+
+    // offset of the rdata of the record added next
+    size_t NextRdata() const { return Data.size() + 12; }
+
+    void Answer(uint16_t type, uint32_t ttl, const std::string& rdata, size_t owner = 12) {
+        Record(type, ttl, rdata, owner);
+        Count(6);
+    }
+
+    // SOA of the parent zone, its names are compressed against the question
+    void Soa(uint32_t ttl, uint32_t minimum) {
+        auto rdata = "\x02ns" + Pointer(Suffix) + "\x04root" + Pointer(Suffix) + U32(1) +
+                     U32(7200) + U32(900) + U32(86400) + U32(minimum);
+        Record(TypeSoa, ttl, rdata, Suffix);
+        Count(8);
+    }
+
+    std::string Data;
+
+ private:
+    void Record(uint16_t type, uint32_t ttl, const std::string& rdata, size_t owner) {
+        Data += Pointer(owner) + U16(type) + U16(1) + U32(ttl) + U16(rdata.size()) + rdata;
+    }
+
+    void Count(size_t offset) {
+        auto count = (uint8_t(Data[offset]) << 8 | uint8_t(Data[offset + 1])) + 1;
+        Data.replace(offset, 2, U16(count));
+    }
+
+    size_t Suffix;  // the parent zone in the question name
+};
+
+std::string Ipv4(const char* addr) {
+    in_addr a;
+    inet_pton(AF_INET, addr, &a);
+    return std::string(reinterpret_cast<const char*>(&a), sizeof(a));
+}
+
+std::string Ipv6(const char* addr) {
+    in6_addr a;
+    inet_pton(AF_INET6, addr, &a);
+    return std::string(reinterpret_cast<const char*>(&a), sizeof(a));
+}
+
+struct TStub {
+    std::map<std::pair<std::string, uint16_t>, int> Queries;  // by name and type, UDP
+    int TcpQueries = 0;
+};
+
+// the replies of the stub to @p query, empty: no reply
+std::vector<std::string> Answer(const TQuery& query, bool tcp) {
+    const auto& name = query.Name;
+    bool a = query.Type == TypeA;
+    if (name == "a.test") {
+        TReplyBuilder reply(query);
+        if (a) {
+            reply.Answer(TypeA, 1, Ipv4("10.0.0.1"));
+            reply.Answer(TypeA, 1, Ipv4("10.0.0.2"));
+        } else {
+            reply.Answer(TypeAaaa, 1, Ipv6("2001:db8::1"));
+        }
+        // dropped by the resolver: another id, and the right id for another question
+        auto otherId = query;
+        otherId.Id ^= 1;
+        TReplyBuilder wrongId(otherId);
+        wrongId.Answer(query.Type, 1, a ? Ipv4("6.6.6.6") : Ipv6("2001:db8::6"));
+        auto otherName = query;
+        otherName.Question = Encode("b.test") + query.Question.substr(query.Question.size() - 4);
+        otherName.Name = "b.test";
+        TReplyBuilder wrongName(otherName);
+        wrongName.Answer(query.Type, 1, a ? Ipv4("6.6.6.7") : Ipv6("2001:db8::7"));
+        return {wrongId.Data, wrongName.Data, reply.Data};
+    }
+    if (name == "cname.test") {
+        TReplyBuilder reply(query);
+        if (a) {
+            // the A record is owned by the CNAME target, a pointer into the CNAME rdata
+            auto target = reply.NextRdata();
+            reply.Answer(TypeCname, 300, "\x04real" + Pointer(12 + 6));
+            reply.Answer(TypeA, 600, Ipv4("10.0.0.3"), target);
+        } else {
+            reply.Soa(120, 30);  // no AAAA records, negative TTL 30s
+        }
+        return {reply.Data};
+    }
+    if (name == "nx.test") {
+        TReplyBuilder reply(query, 3);
+        reply.Soa(60, 1);
+        return {reply.Data};
+    }
+    if (name == "big.test") {
+        TReplyBuilder reply(query, 0, a && !tcp);
+        if (a && tcp) {
+            for (int i = 0; i < 60; ++i) {
+                reply.Answer(TypeA, 60, Ipv4(("10.1.0." + std::to_string(i)).c_str()));
+            }
+        } else if (!a) {
+            reply.Soa(60, 60);
+        }
+        return {reply.Data};
+    }
+    if (name == "topbit.test") {
+        TReplyBuilder reply(query);
+        if (a) {
+            reply.Answer(TypeA, 0x80000001, Ipv4("10.0.0.9"));
+        } else {
+            reply.Soa(60, 60);
+        }
+        return {reply.Data};
+    }
+    if (name == "fail.test") {
+        return {TReplyBuilder(query, 2).Data};
+    }
+    return {};  // silent.test
+}
+
+TVoidTask reply(TLoop<TEpoll>* loop, TDatagramSocket* socket, std::vector<std::string> replies,
+                TAddress to) {
+    // late enough for the lookups of a.test to be coalesced
+    co_await loop->Poller().Sleep(std::chrono::milliseconds(20));
+    for (const auto& data : replies) {
+        co_await socket->SendTo(data.data(), data.size(), to);
+    }
+}
+
+TVoidTask udpServer(TLoop<TEpoll>* loop, TDatagramSocket* socket, TStub* stub) {
+    char buf[512];
+    while (true) {
+        auto res = co_await socket->RecvFrom(buf, sizeof(buf));
+        auto query = res.Size > 0 ? ParseQuery({buf, size_t(res.Size)}) : std::nullopt;
+        if (query) {
+            ++stub->Queries[{query->Name, query->Type}];
+            reply(loop, socket, Answer(*query, false), res.From);
+        }
+    }
+}
+
+TVoidTask tcpConnection(TSocket socket, TStub* stub) {
+    try {
+        uint8_t header[2];
+        co_await TByteReader<TSocket>(socket).Read(header, sizeof(header));
+        std::string msg(header[0] << 8 | header[1], '\0');
+        co_await TByteReader<TSocket>(socket).Read(msg.data(), msg.size());
+        if (auto query = ParseQuery(msg)) {
+            ++stub->TcpQueries;
+            auto replies = Answer(*query, true);
+            auto data = U16(replies.back().size()) + replies.back();
+            co_await TByteWriter<TSocket>(socket).Write(data.data(), data.size());
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "stub: " << ex.what() << "\n";
+    }
+    socket.Close();
+}
+
+TVoidTask tcpServer(TSocket* listener, TStub* stub) {
+    while (true) {
+        tcpConnection(co_await listener->Accept(), stub);
+    }
+}
+
+bool failed = false;
+
+void Check(bool ok, const std::string& what) {
+    std::cout << (ok ? "ok: " : "FAILED: ") << what << "\n";
+    failed |= !ok;
+}
+
+std::string Join(const std::vector<TAddress>& addrs) {
+    std::string out;
+    for (const auto& addr : addrs) {
+        out += (out.empty() ? "" : " ") + addr.ToString();
+    }
+    return out;
+}
+
+// the error of a lookup that is expected to fail
+TFuture<std::string> Error(TResolver* resolver, std::string name) {
+    try {
+        co_await resolver->Resolve(name);
+    } catch (const TTimeoutError&) {
+        co_return "timeout";
+    } catch (const std::exception& ex) {
+        co_return ex.what();
+    }
+    co_return "";
+}
+
+TVoidTask run(TLoop<TEpoll>* loop, TResolver* resolver, TStub* stub, size_t count) {
+    auto& queries = stub->Queries;
+    std::vector<TFuture<std::vector<TAddress>>> lookups;
+    for (int i = 0; i < 3; ++i) {
+        lookups.emplace_back(resolver->Resolve("a.test", 80));
+    }
+    auto results = co_await NNet::All(std::move(lookups));
+    auto start = TClock::now();
+    Check(Join(results[0]) == "10.0.0.1:80 10.0.0.2:80 [2001:db8::1]:80",
+          "A and AAAA, replies to other ids and questions dropped: " + Join(results[0]));
+    Check(results[1] == results[0] && results[2] == results[0], "coalesced lookups agree");
+    Check(queries[{"a.test", TypeA}] == 1 && resolver->Stats().Coalesced == 2,
+          "three lookups of a name, one query");
+
+    auto cname = co_await resolver->Resolve("CName.Test.");
+    Check(Join(cname) == "10.0.0.3:0", "CNAME chain, compressed owner: " + Join(cname));
+    co_await resolver->Resolve("cname.test");
+    Check(queries[{"cname.test", TypeA}] == 1, "cached for min(CNAME, A, SOA) TTLs");
+
+    auto nx = co_await resolver->Resolve("nx.test");
+    co_await resolver->Resolve("nx.test");
+    Check(nx.empty() && queries[{"nx.test", TypeA}] == 1, "NXDOMAIN cached for the SOA TTL");
+
+    auto big = co_await resolver->Resolve("big.test");
+    Check(big.size() == 60 && stub->TcpQueries == 1 && resolver->Stats().TcpRetries == 1,
+          "truncated reply queried again over TCP: " + std::to_string(big.size()));
+
+    co_await resolver->Resolve("topbit.test");
+    co_await resolver->Resolve("topbit.test");
+    Check(queries[{"topbit.test", TypeA}] == 2, "TTL with the top bit set is not cached");
+
+    auto fail = co_await Error(resolver, "fail.test");
+    Check(fail.find("rcode 2") != std::string::npos, "SERVFAIL: " + fail);
+    auto silent = co_await Error(resolver, "silent.test");
+    Check(silent == "timeout", "no reply: " + silent);
+
+    co_await loop->Poller().Sleep(start + std::chrono::milliseconds(1100));
+    co_await resolver->Resolve("a.test");
+    co_await resolver->Resolve("nx.test");
+    Check(queries[{"a.test", TypeA}] == 2 && queries[{"nx.test", TypeA}] == 2,
+          "expired after their TTLs");
+
+    start = TClock::now();
+    for (size_t i = 0; i < count; ++i) {
+        co_await resolver->Resolve("cname.test", 443);
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(TClock::now() - start);
+    std::cout << "cached: " << ns.count() / std::max<size_t>(count, 1) << " ns/lookup\n";
+    loop->Stop();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    int port = argc > 2 ? std::atoi(argv[2]) : 18893;
+
+    TLoop<TEpoll> loop;
+    TAddress addr{"127.0.0.1", port};
+    TDatagramSocket udp(loop.Poller(), addr.Domain());
+    udp.Bind(addr);
+    TSocket tcp(loop.Poller(), addr.Domain());
+    tcp.Bind(addr);
+    tcp.Listen();
+    TStub stub;
+    udpServer(&loop, &udp, &stub);
+    tcpServer(&tcp, &stub);
+
+    TResolver::TOptions options;
+    // nothing listens on the first one, its ECONNREFUSED moves on to the stub
+    options.Nameservers = {TAddress{"127.0.0.1", port + 1}, addr};
+    options.HostsFile = "";
+    options.Timeout = std::chrono::milliseconds(200);
+    options.Attempts = 1;
+    TResolver resolver(loop.Poller(), options);
+    run(&loop, &resolver, &stub, count);
+    loop.Loop();
+    udp.Close();
+    tcp.Close();
+    return failed ? 1 : 0;
+}
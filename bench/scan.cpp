@@ -0,0 +1,80 @@
+#include "../src/scan.h"
+#include "../src/sockutils.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using NNet::EScanLevel;
+using NNet::ScanDelimiters;
+using NNet::TLine;
+using NNet::TZeroCopyLineSplitter;
+
+// Newline scanning: string_view::find per line against one ScanDelimiters() pass per
+// chunk with every implementation, then the splitter fed chunk by chunk.
+//   scan [line length] [megabytes]
+
+namespace {
+
+using TClock = std::chrono::steady_clock;
+
+double Seconds(TClock::time_point start) {
+    return std::chrono::duration<double>(TClock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t lineLength = argc > 1 ? std::atoll(argv[1]) : 64;
+    size_t megabytes = argc > 2 ? std::atoll(argv[2]) : 256;
+    constexpr size_t chunk_size = 4096;
+
+    std::string chunk;
+    while (chunk.size() + lineLength <= chunk_size) {
+        chunk.append(lineLength - 1, 'x');
+        chunk += '\n';
+    }
+    size_t rounds = (megabytes << 20) / chunk.size();
+    double mb = static_cast<double>(rounds * chunk.size()) / (1 << 20);
+    size_t found = 0;
+
+    auto start = TClock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        std::string_view view = chunk;
+        for (size_t pos = view.find('\n'); pos != std::string_view::npos;
+             pos = view.find('\n', pos + 1)) {
+            ++found;
+        }
+    }
+    std::cout << "find: " << static_cast<size_t>(mb / Seconds(start)) << " MB/s\n";
+
+    std::vector<size_t> positions;
+    for (auto [level, name] : {std::pair{EScanLevel::Scalar, "scalar"},
+                               std::pair{EScanLevel::Sse2, "sse2"},
+                               std::pair{EScanLevel::Avx2, "avx2"}}) {
+        if (level > NNet::BestScanLevel()) {
+            continue;
+        }
+        start = TClock::now();
+        for (size_t i = 0; i < rounds; ++i) {
+            positions.clear();
+            ScanDelimiters(chunk.data(), chunk.size(), '\n', 0, positions, level);
+            found += positions.size();
+        }
+        std::cout << name << ": " << static_cast<size_t>(mb / Seconds(start)) << " MB/s\n";
+    }
+
+    TZeroCopyLineSplitter splitter(chunk_size);
+    std::vector<TLine> lines;
+    start = TClock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        splitter.Push(chunk.data(), chunk.size());
+        lines.clear();
+        found += splitter.PopAll(lines);
+    }
+    std::cout << "splitter: " << static_cast<size_t>(mb / Seconds(start)) << " MB/s\n";
+    return found == 0;
+}
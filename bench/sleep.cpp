@@ -0,0 +1,69 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+
+#include <sys/prctl.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using NNet::TClock;
+using NNet::TEpoll;
+using NNet::TLoop;
+using NNet::TUring;
+using NNet::TVoidTask;
+
+// Lateness of short Sleep()s: how long after its deadline a sleeping coroutine is resumed.
+//   sleep [count] [epoll|uring]
+// Exits with 1 if the p99 lateness is 100us or more. The timer slack of the thread is
+// lowered to 1ns, the default 50us would be added to every epoll wait.
+
+namespace {
+
+template <typename TPoller>
+TVoidTask sleeper(TLoop<TPoller>* loop, size_t count, std::vector<int64_t>* lateness) {
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int64_t> duration(20, 2000);
+    for (size_t i = 0; i < count; ++i) {
+        auto deadline = TClock::now() + std::chrono::microseconds(duration(rng));
+        co_await loop->Poller().Sleep(deadline);
+        lateness->push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(TClock::now() - deadline)
+                .count());
+    }
+    loop->Stop();
+}
+
+template <typename TPoller>
+int run(size_t count) {
+    TLoop<TPoller> loop;
+    std::vector<int64_t> lateness;
+    lateness.reserve(count);
+    sleeper(&loop, count, &lateness);
+    loop.Loop();
+
+    std::sort(lateness.begin(), lateness.end());
+    auto percentile = [&](double p) {
+        return lateness[std::min(lateness.size() - 1, static_cast<size_t>(lateness.size() * p))] /
+               1000.0;
+    };
+    double p99 = percentile(0.99);
+    std::cout << count << " sleeps of 20us-2ms, lateness us: p50 " << percentile(0.5) << ", p90 "
+              << percentile(0.9) << ", p99 " << p99 << ", max " << lateness.back() / 1000.0
+              << "\n";
+    return p99 < 100 ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 2000;
+    std::string method = argc > 2 ? argv[2] : "epoll";
+    prctl(PR_SET_TIMERSLACK, 1);
+    if (method == "uring") {
+        return run<TUring>(count);
+    }
+    return run<TEpoll>(count);
+}
@@ -0,0 +1,167 @@
+#include "../src/timerwheel.h"
+
+#include <algorithm>
+#include <coroutine>
+#include <cstdlib>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <vector>
+
+using NNet::TClock;
+using NNet::THandle;
+using NNet::TTime;
+using NNet::TTimer;
+using NNet::TTimerId;
+using NNet::TTimerWheel;
+
+namespace {
+
+// The priority_queue timers TPollerBase used before the wheel: cancel pushes a tombstone.
+struct THeapTimers {
+    unsigned Add(TTime deadline, THandle handle) {
+        timers.emplace(TTimer{deadline, id, handle});
+        return id++;
+    }
+
+    void Remove(unsigned timerId, TTime deadline) {
+        if (timerId != lastFired) {
+            timers.emplace(TTimer{deadline, timerId, THandle{}});
+        }
+    }
+
+    size_t Process(TTime now) {
+        size_t fired = 0;
+        bool first = true;
+        unsigned prevId = 0;
+        while (!timers.empty() && timers.top().Deadline <= now) {
+            TTimer timer = timers.top();
+            timers.pop();
+            if ((first || prevId != timer.Id) && timer.Handle) {
+                lastFired = timer.Id;
+                timer.Handle.resume();
+                ++fired;
+            }
+            first = false;
+            prevId = timer.Id;
+        }
+        return fired;
+    }
+
+    std::priority_queue<TTimer> timers;
+    unsigned id = 0;
+    unsigned lastFired = -1;
+};
+
+struct TResult {
+    double AddNs;
+    double CancelNs;
+    double ExpireNs;
+    size_t SizeAfterCancel;
+    size_t Fired;
+};
+
+double NsPerOp(TTime start, size_t ops) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(TClock::now() - start);
+    return ops ? static_cast<double>(ns.count()) / ops : 0;
+}
+
+// Time is simulated: timers are spread over `span` and the clock advances by `step`,
+// as a loop waking up every `step` would see it.
+template <typename TAdd, typename TCancel, typename TExpire, typename TSize>
+TResult Run(const std::vector<TTime>& deadlines, const std::vector<size_t>& cancel, TTime end,
+            std::chrono::milliseconds step, TTime base, TAdd add, TCancel remove, TExpire expire,
+            TSize size) {
+    TResult r{};
+    auto start = TClock::now();
+    for (auto deadline : deadlines) {
+        add(deadline);
+    }
+    r.AddNs = NsPerOp(start, deadlines.size());
+
+    start = TClock::now();
+    for (auto i : cancel) {
+        remove(i);
+    }
+    r.CancelNs = NsPerOp(start, cancel.size());
+    r.SizeAfterCancel = size();
+
+    start = TClock::now();
+    for (auto now = base; now <= end; now += step) {
+        r.Fired += expire(now);
+    }
+    r.ExpireNs = NsPerOp(start, deadlines.size() - cancel.size());
+    return r;
+}
+
+void Print(const char* name, const TResult& r) {
+    std::cout << name << ": add " << r.AddNs << " ns/op, cancel " << r.CancelNs
+              << " ns/op, expire " << r.ExpireNs << " ns/timer, size after cancel "
+              << r.SizeAfterCancel << ", fired " << r.Fired << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    int cancelPercent = argc > 2 ? std::atoi(argv[2]) : 90;
+    auto span = std::chrono::seconds(argc > 3 ? std::atoi(argv[3]) : 30);
+    auto step = std::chrono::milliseconds(1);
+
+    std::mt19937_64 rng(42);
+    auto base = TClock::now();
+    std::uniform_int_distribution<int64_t> offset(
+        1, std::chrono::duration_cast<std::chrono::microseconds>(span).count());
+    std::vector<TTime> deadlines(count);
+    for (auto& deadline : deadlines) {
+        deadline = base + std::chrono::microseconds(offset(rng));
+    }
+    std::vector<size_t> cancel;
+    for (size_t i = 0; i < count; ++i) {
+        if (static_cast<int>(rng() % 100) < cancelPercent) {
+            cancel.push_back(i);
+        }
+    }
+    std::shuffle(cancel.begin(), cancel.end(), rng);
+    auto end = base + span + step;
+    THandle noop = std::noop_coroutine();
+
+    std::cout << count << " timers over " << span.count() << "s, " << cancel.size()
+              << " cancelled\n";
+
+    {
+        THeapTimers heap;
+        std::vector<unsigned> ids(count);
+        size_t next = 0;
+        auto r = Run(
+            deadlines, cancel, end, step, base,
+            [&](TTime deadline) { ids[next++] = heap.Add(deadline, noop); },
+            [&](size_t i) { heap.Remove(ids[i], deadlines[i]); },
+            [&](TTime now) { return heap.Process(now); }, [&]() { return heap.timers.size(); });
+        Print("heap ", r);
+    }
+
+    {
+        TTimerWheel wheel(step, base);
+        std::vector<TTimerId> ids(count);
+        size_t next = 0;
+        auto r = Run(
+            deadlines, cancel, end, step, base,
+            [&](TTime deadline) { ids[next++] = wheel.Add(deadline, noop); },
+            [&](size_t i) { wheel.Remove(ids[i]); },
+            [&](TTime now) {
+                wheel.Advance(now);
+                size_t fired = 0;
+                TTimerId id;
+                THandle handle;
+                while (wheel.PopExpired(&id, &handle)) {
+                    handle.resume();
+                    ++fired;
+                }
+                return fired;
+            },
+            [&]() { return wheel.Size(); });
+        Print("wheel", r);
+    }
+    return 0;
+}
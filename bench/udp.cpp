@@ -0,0 +1,114 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using NNet::TAddress;
+using NNet::TClock;
+using NNet::TDatagram;
+using NNet::TDatagramSocket;
+using NNet::TEpoll;
+using NNet::TLoop;
+using NNet::TVoidTask;
+
+// UDP over loopback: datagrams per second with one syscall per datagram, with
+// recvmmsg/sendmmsg batches and with GSO/GRO on top of the batches.
+//   udp [datagrams] [single|batch|gso] [batch size]
+
+namespace {
+
+constexpr size_t datagram_size = 1200;
+constexpr int port = 9400;
+
+struct TStats {
+    size_t Received = 0;
+    size_t Syscalls = 0;
+};
+
+TVoidTask receiver(TDatagramSocket* socket, std::string mode, size_t batchSize, TStats* stats) {
+    if (mode == "single") {
+        char buf[datagram_size];
+        while (true) {
+            auto res = co_await socket->RecvFrom(buf, sizeof(buf));
+            ++stats->Syscalls;
+            stats->Received += res.Size > 0;
+        }
+    }
+    // with GRO one buffer takes up to 64KB of coalesced datagrams
+    size_t bufferSize = mode == "gso" ? 65536 : datagram_size;
+    std::vector<char> storage(batchSize * bufferSize);
+    std::vector<TDatagram> batch(batchSize);
+    while (true) {
+        for (size_t i = 0; i < batchSize; ++i) {
+            batch[i].Data = &storage[i * bufferSize];
+            batch[i].Size = bufferSize;
+        }
+        int n = co_await socket->RecvBatch(batch);
+        ++stats->Syscalls;
+        for (int i = 0; i < n; ++i) {
+            size_t segment = batch[i].SegmentSize ? batch[i].SegmentSize : batch[i].Size;
+            stats->Received += (batch[i].Size + segment - 1) / segment;
+        }
+    }
+}
+
+TVoidTask sender(TLoop<TEpoll>* loop, TDatagramSocket* socket, std::string mode, size_t count,
+                 size_t batchSize, size_t* syscalls) {
+    TAddress to{"127.0.0.1", port};
+    // GSO: every message of the batch carries 32 datagrams
+    size_t perMessage = mode == "gso" ? 32 : 1;
+    std::vector<char> payload(datagram_size * perMessage, 'x');
+    // the same number of datagrams per call, not to overflow the receive buffer
+    std::vector<TDatagram> batch(std::max<size_t>(1, batchSize / perMessage));
+    for (auto& datagram : batch) {
+        datagram = {payload.data(), payload.size(), to,
+                    static_cast<uint16_t>(mode == "gso" ? datagram_size : 0)};
+    }
+    size_t sent = 0;
+    while (sent < count) {
+        if (mode == "single") {
+            sent += co_await socket->SendTo(payload.data(), datagram_size, to) > 0;
+        } else {
+            int n = co_await socket->SendBatch(batch);
+            sent += n > 0 ? n * perMessage : 0;
+        }
+        ++*syscalls;
+        co_await loop->Poller().Yield();  // let the receiver drain its buffer
+    }
+    co_await loop->Poller().Sleep(std::chrono::milliseconds(100));
+    loop->Stop();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    std::string mode = argc > 2 ? argv[2] : "batch";
+    size_t batchSize = argc > 3 ? std::atoll(argv[3]) : 32;
+
+    TLoop<TEpoll> loop;
+    TDatagramSocket in(loop.Poller(), AF_INET);
+    in.Bind(TAddress{"127.0.0.1", port});
+    if (mode == "gso" && !in.EnableGro()) {
+        std::cerr << "UDP_GRO is not supported\n";
+        return 1;
+    }
+    TDatagramSocket out(loop.Poller(), AF_INET);
+
+    TStats stats;
+    size_t sendSyscalls = 0;
+    auto start = TClock::now();
+    receiver(&in, mode, batchSize, &stats);
+    sender(&loop, &out, mode, count, batchSize, &sendSyscalls);
+    loop.Loop();
+    auto seconds = std::chrono::duration<double>(TClock::now() - start).count();
+
+    std::cout << mode << ": " << stats.Received << " of " << count << " datagrams received, "
+              << static_cast<size_t>(stats.Received / seconds) << " datagrams/s, "
+              << sendSyscalls << " send and " << stats.Syscalls << " receive calls\n";
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+
+#include <signal.h>
+#include <atomic>
+#include <iostream>
+#include <string>
+
+using NNet::EListenMode;
+using NNet::TAddress;
+using NNet::TEpoll;
+using NNet::TLoop;
+using NNet::TLoopGroup;
+using NNet::TUring;
+using NNet::TVoidTask;
+
+// Echo server on all cores: every loop accepts on its own listener and serves
+// the connections it accepted.
+//   echogroup [threads] [reuseport|exclusive] [epoll|epoll-et|uring] [port]
+// Stop with Ctrl-C, the number of connections accepted by each loop is printed.
+
+template <typename TPoller>
+TVoidTask client_handler(typename TPoller::TSocket socket) {
+    char buffer[4096];
+    try {
+        ssize_t size;
+        while ((size = co_await socket.ReadSome(buffer, sizeof(buffer))) != 0) {
+            if (size > 0) {
+                co_await socket.WriteSome(buffer, size);
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Exception: " << ex.what() << "\n";
+    }
+    co_return;
+}
+
+template <typename TPoller>
+TVoidTask server(typename TPoller::TSocket socket, std::atomic<size_t>* accepted) {
+    try {
+        while (true) {
+            // drains the backlog per wakeup, which matters during connection storms
+            size_t count = co_await socket.AcceptBatch([](typename TPoller::TSocket client) {
+                client_handler<TPoller>(std::move(client));
+            });
+            accepted->fetch_add(count, std::memory_order_relaxed);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Exception: " << ex.what() << "\n";
+    }
+    co_return;
+}
+
+template <typename TPoller>
+int run(size_t threads, EListenMode mode, int port, bool edgeTriggered = false) {
+    // block the signals before the loop threads start, they are taken by sigwait below
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    TLoopGroup<TPoller> group(threads);
+    if constexpr (std::is_same_v<TPoller, TEpoll>) {
+        for (size_t i = 0; i < group.Size(); ++i) {
+            group.Poller(i).SetEdgeTriggered(edgeTriggered);
+        }
+    }
+    auto listeners = group.Listen(TAddress{"0.0.0.0", port}, mode, 1024);
+    std::vector<std::atomic<size_t>> accepted(group.Size());
+    group.Start([&](size_t i, TLoop<TPoller>&) {
+        server<TPoller>(std::move(listeners[i]), &accepted[i]);
+    });
+    std::cout << "Listening on " << port << " with " << group.Size() << " loops\n";
+
+    int sig;
+    sigwait(&signals, &sig);
+    group.Stop();
+    group.Join();
+    for (size_t i = 0; i < accepted.size(); ++i) {
+        std::cout << "loop " << i << ": " << accepted[i].load() << " connections\n";
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    size_t threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    auto mode = argc > 2 && std::string(argv[2]) == "exclusive" ? EListenMode::Exclusive
+                                                                : EListenMode::ReusePort;
+    std::string poller = argc > 3 ? argv[3] : "epoll";
+    int port = argc > 4 ? std::stoi(argv[4]) : 8888;
+
+    if (poller == "uring") {
+        return run<TUring>(threads, mode, port);
+    }
+    return run<TEpoll>(threads, mode, port, poller == "epoll-et");
+}
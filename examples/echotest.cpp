@@ -2,19 +2,24 @@
 #include "../src/promises.h"
 
 #include <signal.h>
+#include <iostream>
 
 using NNet::TAddress;
 using NNet::TEpoll;
-using NNet::TSocket;
+using NNet::TLoop;
+using NNet::TUring;
 using NNet::TVoidTask;
-using TLoop = NNet::TLoop<TEpoll>;
 
-TVoidTask client_handler(TSocket socket, TLoop* loop) {
+template <typename TPoller>
+TVoidTask client_handler(typename TPoller::TSocket socket, TLoop<TPoller>* loop) {
     char buffer[128] = {0};
     ssize_t size = 0;
 
     try {
-        while ((size = co_await socket.ReadSome(buffer, sizeof(buffer))) > 0) {
+        while ((size = co_await socket.ReadSome(buffer, sizeof(buffer))) != 0) {
+            if (size < 0) {
+                continue;  // spurious wakeup, retry
+            }
             std::cerr << "Received from client: '" << std::string_view(buffer, size) << "' ("
                       << size << ") bytes \n";
             co_await socket.WriteSome(buffer, size);
@@ -28,9 +33,10 @@ TVoidTask client_handler(TSocket socket, TLoop* loop) {
     co_return;
 }
 
-TVoidTask server(TLoop* loop) {
+template <typename TPoller>
+TVoidTask server(TLoop<TPoller>* loop) {
     TAddress addr{"127.0.0.1", 8888};
-    TSocket socket(loop->Poller(), addr.Domain());
+    typename TPoller::TSocket socket(loop->Poller(), addr.Domain());
     socket.Bind(addr);
     socket.Listen();
     std::cout << "Server started Listen\n";
@@ -39,7 +45,7 @@ TVoidTask server(TLoop* loop) {
         while (true) {
             auto client = co_await socket.Accept();
             std::cout << "accepted" << std::endl;
-            client_handler(std::move(client), loop);
+            client_handler<TPoller>(std::move(client), loop);
         }
     } catch (const std::exception& ex) {
         std::cout << "Exception: " << ex.what() << "\n";
@@ -47,7 +53,8 @@ TVoidTask server(TLoop* loop) {
     co_return;
 }
 
-TVoidTask client(TLoop* loop, int clientId) {
+template <typename TPoller>
+TVoidTask client(TLoop<TPoller>* loop, int clientId) {
     char buffer[128] = "Hello XXX/YYY";
     char rcv[128] = {0};
     int messageNo = 1;
@@ -57,7 +64,7 @@ TVoidTask client(TLoop* loop, int clientId) {
 
     try {
         TAddress addr{"127.0.0.1", 8888};
-        TSocket socket(loop->Poller(), addr.Domain());
+        typename TPoller::TSocket socket(loop->Poller(), addr.Domain());
         co_await socket.Connect(addr);
 
         do {
@@ -77,21 +84,39 @@ TVoidTask client(TLoop* loop, int clientId) {
     co_return;
 }
 
+template <typename TPoller>
+void run(int clients, bool edgeTriggered = false) {
+    TLoop<TPoller> loop;
+    if constexpr (std::is_same_v<TPoller, TEpoll>) {
+        loop.Poller().SetEdgeTriggered(edgeTriggered);
+    }
+    server(&loop);
+    for (int i = 0; i < clients; i++) {
+        client(&loop, i + 1);
+    }
+    std::cout << "Start loop..." << std::endl;
+    loop.Loop();
+}
+
 int main(int argc, char** argv) {
-    TLoop loop;
     int clients = 0;
+    std::string method = "epoll";
     if (argc > 1) {
         clients = atoi(argv[1]);
     }
+    if (argc > 2) {
+        method = argv[2];
+    }
     if (clients == 0) {
         clients = 1;
     }
 
-    server(&loop);
-    for (int i = 0; i < clients; i++) {
-        client(&loop, i + 1);
+    if (method == "uring") {
+        run<TUring>(clients);
+    } else if (method == "epoll-et") {
+        run<TEpoll>(clients, true);
+    } else {
+        run<TEpoll>(clients);
     }
-    std::cout << "Start loop..." << std::endl;
-    loop.Loop();
     return 0;
 }
@@ -0,0 +1,73 @@
+#include "../src/all.h"
+#include "../src/promises.h"
+
+#include <signal.h>
+#include <iostream>
+#include <string>
+
+using NNet::TAddress;
+using NNet::TEpoll;
+using NNet::TFileHandle;
+using NNet::TLoop;
+using NNet::TUring;
+using NNet::TVoidTask;
+
+// Sends a file to every client and closes the connection, the file is never read
+// into user space.
+//   fileserver <path> [epoll|uring] [port]
+//   nc 127.0.0.1 8888 > copy
+
+template <typename TPoller>
+TVoidTask client_handler(typename TPoller::TSocket socket, TLoop<TPoller>* loop,
+                         const char* path) {
+    try {
+        TFileHandle file(path, loop->Poller());
+        auto size = file.Size();
+        size_t sent = co_await socket.SendFile(file.Fd(), 0, size);
+        std::cout << "sent " << sent << " of " << size << " bytes\n";
+        file.Close();
+    } catch (const std::exception& ex) {
+        std::cerr << "Exception: " << ex.what() << "\n";
+    }
+    socket.Close();
+    co_return;
+}
+
+template <typename TPoller>
+TVoidTask server(TLoop<TPoller>* loop, const char* path, int port) {
+    try {
+        typename TPoller::TSocket socket(loop->Poller(), AF_INET);
+        socket.Bind(TAddress{"0.0.0.0", port});
+        socket.Listen();
+        while (true) {
+            auto client = co_await socket.Accept();
+            client_handler<TPoller>(std::move(client), loop, path);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Exception: " << ex.what() << "\n";
+    }
+    co_return;
+}
+
+template <typename TPoller>
+void run(const char* path, int port) {
+    TLoop<TPoller> loop;
+    server(&loop, path, port);
+    loop.Loop();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <path> [epoll|uring] [port]\n";
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    std::string method = argc > 2 ? argv[2] : "epoll";
+    int port = argc > 3 ? std::stoi(argv[3]) : 8888;
+    if (method == "uring") {
+        run<TUring>(argv[1], port);
+    } else {
+        run<TEpoll>(argv[1], port);
+    }
+    return 0;
+}
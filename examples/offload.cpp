@@ -0,0 +1,72 @@
+#include "../src/all.h"
+#include "../src/corochain.h"
+#include "../src/promises.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using NNet::TEpoll;
+using NNet::TLoop;
+using NNet::TThreadPool;
+using NNet::TValueTask;
+using NNet::TVoidTask;
+
+// CPU-bound work runs on a TThreadPool while the loop keeps serving its timers.
+//   offload [jobs] [size in MB]
+
+uint64_t fnv1a(const std::vector<char>& data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : data) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+TValueTask<uint64_t> checksum(TThreadPool* pool, TLoop<TEpoll>* loop, size_t size, int seed) {
+    std::vector<char> data(size, static_cast<char>(seed));
+    co_return co_await pool->Run(loop->Poller(), [&] { return fnv1a(data); });
+}
+
+TVoidTask ticker(TLoop<TEpoll>* loop, int* ticks) {
+    while (true) {
+        co_await loop->Poller().Sleep(std::chrono::milliseconds(10));
+        ++*ticks;
+    }
+}
+
+TVoidTask run(TThreadPool* pool, TLoop<TEpoll>* loop, int jobs, size_t size, int* ticks) {
+    auto start = NNet::TClock::now();
+    std::vector<TValueTask<uint64_t>> tasks;
+    for (int i = 0; i < jobs; ++i) {
+        tasks.emplace_back(checksum(pool, loop, size, i));
+    }
+    for (auto& task : tasks) {
+        uint64_t hash = co_await task;
+        std::cout << "checksum: " << std::hex << hash << std::dec << "\n";
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(NNet::TClock::now() - start);
+    std::cout << jobs << " jobs in " << ms.count() << "ms, the loop ticked " << *ticks
+              << " times meanwhile\n";
+
+    try {
+        co_await pool->Run(loop->Poller(), [] { throw std::runtime_error("failed in the pool"); });
+    } catch (const std::exception& ex) {
+        std::cout << "Exception: " << ex.what() << "\n";
+    }
+    loop->Stop();
+}
+
+int main(int argc, char** argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 8;
+    size_t size = (argc > 2 ? std::stoul(argv[2]) : 64) << 20;
+
+    TThreadPool pool;
+    TLoop<TEpoll> loop;
+    int ticks = 0;
+    ticker(&loop, &ticks);
+    run(&pool, &loop, jobs, size, &ticks);
+    loop.Loop();
+    return 0;
+}
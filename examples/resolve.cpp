@@ -0,0 +1,55 @@
+#include "../src/all.h"
+#include "../src/corochain.h"
+#include "../src/promises.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using NNet::TAddress;
+using NNet::TEpoll;
+using NNet::TLoop;
+using NNet::TResolver;
+using NNet::TVoidTask;
+
+// Resolves host names with TResolver, the second lookup of a name comes from the cache.
+//   resolve [nameserver] [host...]
+
+TVoidTask run(TLoop<TEpoll>* loop, TResolver* resolver, std::vector<std::string> names) {
+    for (int round = 0; round < 2; ++round) {
+        for (const auto& name : names) {
+            try {
+                auto addrs = co_await resolver->Resolve(name);
+                std::cout << name << ":";
+                for (const auto& addr : addrs) {
+                    std::cout << " " << addr.ToString();
+                }
+                std::cout << (addrs.empty() ? " no addresses\n" : "\n");
+            } catch (const std::exception& ex) {
+                std::cout << name << ": " << ex.what() << "\n";
+            }
+        }
+    }
+    auto stats = resolver->Stats();
+    std::cout << stats.Queries << " queries, " << stats.CacheHits << " cache hits, "
+              << stats.HostsHits << " hosts file hits\n";
+    loop->Stop();
+}
+
+int main(int argc, char** argv) {
+    TResolver::TOptions options;
+    if (argc > 1 && std::string(argv[1]) != "-") {
+        options.Nameservers.emplace_back(argv[1], 53);
+    }
+    std::vector<std::string> names(argv + std::min(argc, 2), argv + argc);
+    if (names.empty()) {
+        names = {"localhost", "example.com"};
+    }
+
+    TLoop<TEpoll> loop;
+    TResolver resolver(loop.Poller(), options);
+    run(&loop, &resolver, names);
+    loop.Loop();
+    return 0;
+}
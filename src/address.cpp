@@ -74,10 +74,6 @@ std::pair<const sockaddr*, int> TAddress::RawAddr() const {
     }
 }
 
-bool TAddress::operator==(const TAddress& other) const {
-    return memcmp(&Addr_, &other.Addr_, sizeof(Addr_)) == 0;
-}
-
 std::string TAddress::ToString() const {
     char buf[1024];
     if (const auto* val = std::get_if<sockaddr_in>(&Addr_)) {
@@ -8,6 +8,9 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <string>
 #include <variant>
 
@@ -90,12 +93,45 @@ class TAddress {
      * @brief Equality operator for TAddress.
      *
      * Two addresses are considered equal if they share the same protocol family
-     * (IPv4 vs. IPv6) and identical IP and port values.
+     * (IPv4 vs. IPv6) and identical IP and port values (and IPv6 scope id). Padding and
+     * the IPv6 flow label are ignored, so addresses from the kernel compare as parsed ones.
      *
      * @param other Another TAddress instance to compare with.
      * @return True if both addresses are equal; otherwise false.
      */
-    bool operator==(const TAddress& other) const;
+    bool operator==(const TAddress& other) const {
+        if (Addr_.index() != other.Addr_.index()) {
+            return false;
+        }
+        if (const auto* a = std::get_if<sockaddr_in>(&Addr_)) {
+            const auto& b = *std::get_if<sockaddr_in>(&other.Addr_);
+            return a->sin_port == b.sin_port && a->sin_addr.s_addr == b.sin_addr.s_addr;
+        }
+        const auto& a = *std::get_if<sockaddr_in6>(&Addr_);
+        const auto& b = *std::get_if<sockaddr_in6>(&other.Addr_);
+        return a.sin6_port == b.sin6_port && a.sin6_scope_id == b.sin6_scope_id &&
+               memcmp(&a.sin6_addr, &b.sin6_addr, sizeof(a.sin6_addr)) == 0;
+    }
+    /**
+     * @brief Hash of the fields compared by operator==, for unordered containers.
+     */
+    size_t Hash() const {
+        uint64_t h;
+        if (const auto* a = std::get_if<sockaddr_in>(&Addr_)) {
+            h = (uint64_t(a->sin_addr.s_addr) << 16) | a->sin_port;
+        } else {
+            const auto& a6 = *std::get_if<sockaddr_in6>(&Addr_);
+            uint64_t words[2];
+            memcpy(words, &a6.sin6_addr, sizeof(words));
+            h = words[0] ^ (words[1] * 0x9e3779b97f4a7c15ULL) ^
+                (uint64_t(a6.sin6_scope_id) << 16 | a6.sin6_port);
+        }
+        // finalizer of MurmurHash3: every input bit affects the low bits used by the buckets
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
     /**
      * @brief Gets the domain (address family) of the stored address.
      *
@@ -129,4 +165,9 @@ class TAddress {
     std::variant<sockaddr_in, sockaddr_in6> Addr_ = {};
 };
 
-}  // namespace NNet
\ No newline at end of file
+}  // namespace NNet
+
+template <>
+struct std::hash<NNet::TAddress> {
+    size_t operator()(const NNet::TAddress& addr) const noexcept { return addr.Hash(); }
+};
\ No newline at end of file
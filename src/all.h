@@ -1,8 +1,22 @@
 #pragma once
 
 #include "base.h"
+#include "bufferpool.h"
+#include "connpool.h"
+#include "datagram.h"
 #include "epoll.h"
+#include "framepool.h"
+#include "framing.h"
 #include "loop.h"
+#include "loopgroup.h"
+#include "metrics.h"
 #include "poller.h"
 #include "promises.h"
+#include "resolver.h"
+#include "scan.h"
 #include "socket.h"
+#include "threadpool.h"
+#include "timerwheel.h"
+#include "trace.h"
+#include "uring.h"
+#include "watchdog.h"
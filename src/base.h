@@ -2,9 +2,10 @@
 
 #include <chrono>
 #include <coroutine>
+#include <cstdint>
 // #include <cstring>
 // #include <iostream>
-// #include <stdexcept>
+#include <stdexcept>
 #include <tuple>
 
 #include <time.h>
@@ -14,6 +15,15 @@ namespace NNet {
 using TClock = std::chrono::steady_clock;
 using TTime = TClock::time_point;
 using THandle = std::coroutine_handle<>;
+using TTimerId = uint64_t;  // 0 is never a valid timer id
+
+/**
+ * @brief Thrown by an operation whose deadline passed before it completed.
+ */
+class TTimeoutError : public std::runtime_error {
+ public:
+    using std::runtime_error::runtime_error;
+};
 
 struct TTimer {
     TTime Deadline;
@@ -29,11 +39,12 @@ struct THandlePair {
     THandle Read;
     THandle Write;
     THandle RHup;
+    THandle Err;
 };
 
 struct TEvent {
     int Fd;
-    enum { READ = 1, WRITE = 2, RHUP = 4 };
+    enum { READ = 1, WRITE = 2, RHUP = 4, ERR = 8 };
     int Type;
     THandle Handle;
 
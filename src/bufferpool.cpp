@@ -0,0 +1,121 @@
+#include <sys/mman.h>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include "bufferpool.h"
+
+namespace NNet {
+
+namespace {
+
+int ClassOf(size_t size) {
+    int index = 0;
+    for (size_t classSize = TBufferPool::MinBufferSize; classSize < size; classSize *= 2) {
+        ++index;
+    }
+    return index;
+}
+
+}  // namespace
+
+void TPooledBuffer::Release() {
+    if (pool_) {
+        pool_->Release(data_, size_);
+    } else {
+        delete[] data_;
+    }
+    pool_ = nullptr;
+    data_ = nullptr;
+    size_ = 0;
+}
+
+TBufferPool::TBufferPool() : TBufferPool(TOptions{}) {}
+
+TBufferPool::TBufferPool(TOptions options) {
+    SetOptions(options);
+}
+
+TBufferPool::~TBufferPool() {
+    for (auto& slab : slabs_) {
+        munmap(slab.Data, slab.Size);
+    }
+}
+
+void TBufferPool::SetOptions(TOptions options) {
+    if (options.SlabSize < MaxBufferSize || options.SlabSize % MaxBufferSize != 0) {
+        throw std::invalid_argument("Slab size must be a multiple of the largest buffer size");
+    }
+    options_ = options;
+}
+
+TPooledBuffer TBufferPool::Acquire(size_t size) {
+    int index = size > MaxBufferSize ? -1 : ClassOf(size);
+    if (index >= 0 && (free_[index] || bump_[index] != bump_end_[index] || Grow(index))) {
+        size_t bufferSize = MinBufferSize << index;
+        char* data;
+        if (free_[index]) {
+            data = reinterpret_cast<char*>(free_[index]);
+            free_[index] = free_[index]->Next;
+        } else {
+            // carved lazily, the pages of a fresh slab are not touched before use
+            data = bump_[index];
+            bump_[index] += bufferSize;
+        }
+        --stats_.Cached;
+        ++stats_.Acquires;
+        stats_.PeakInUse = std::max(stats_.PeakInUse, ++stats_.InUse);
+        return TPooledBuffer(this, data, bufferSize);
+    }
+    ++stats_.Overflows;
+    return TPooledBuffer(nullptr, new char[size], size);
+}
+
+void TBufferPool::Release(char* data, size_t size) {
+    int index = ClassOf(size);
+    auto* buffer = reinterpret_cast<TFreeBuffer*>(data);
+    buffer->Next = free_[index];
+    free_[index] = buffer;
+    ++stats_.Cached;
+    ++stats_.Releases;
+    --stats_.InUse;
+}
+
+bool TBufferPool::Grow(int index) {
+    size_t size = options_.SlabSize;
+    if (options_.MaxBytes && stats_.MappedBytes + size > options_.MaxBytes) {
+        return false;
+    }
+    void* p = MAP_FAILED;
+    if (options_.HugePages) {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                 MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+        stats_.HugeSlabs += p != MAP_FAILED;
+    }
+    if (p == MAP_FAILED) {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+        if (options_.HugePages) {
+            madvise(p, size, MADV_HUGEPAGE);  // no reserved huge pages, ask for THP
+        }
+    }
+    slabs_.push_back({static_cast<char*>(p), size});
+    ++stats_.Slabs;
+    stats_.MappedBytes += size;
+    // a slab serves one size class
+    bump_[index] = static_cast<char*>(p);
+    bump_end_[index] = bump_[index] + size;
+    stats_.Cached += size / (MinBufferSize << index);
+    return true;
+}
+
+std::vector<std::span<char>> TBufferPool::Slabs() const {
+    std::vector<std::span<char>> slabs;
+    for (auto& slab : slabs_) {
+        slabs.emplace_back(slab.Data, slab.Size);
+    }
+    return slabs;
+}
+
+}  // namespace NNet
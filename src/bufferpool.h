@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace NNet {
+
+struct TBufferPoolStats {
+    uint64_t Acquires = 0;     // buffers handed out from the slabs
+    uint64_t Releases = 0;     // buffers given back to the slabs
+    uint64_t InUse = 0;        // buffers borrowed right now
+    uint64_t PeakInUse = 0;    // max of InUse
+    uint64_t Cached = 0;       // free buffers ready to be handed out
+    uint64_t Slabs = 0;        // slabs mapped
+    uint64_t HugeSlabs = 0;    // of them backed by explicit huge pages
+    uint64_t MappedBytes = 0;  // memory held by the slabs
+    uint64_t Overflows = 0;    // buffers served by the heap: over the limit or too large
+};
+
+class TBufferPool;
+
+/**
+ * @brief A buffer borrowed from TBufferPool, returned on destruction.
+ *
+ * Buffers the pool could not serve from a slab have no pool and are freed to the heap.
+ */
+class TPooledBuffer {
+ public:
+    TPooledBuffer() = default;
+    TPooledBuffer(TPooledBuffer&& other) { *this = std::move(other); }
+    TPooledBuffer& operator=(TPooledBuffer&& other) {
+        if (this != &other) {
+            Release();
+            pool_ = other.pool_;
+            data_ = other.data_;
+            size_ = other.size_;
+            other.pool_ = nullptr;
+            other.data_ = nullptr;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+    ~TPooledBuffer() { Release(); }
+
+    char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+    operator bool() const { return data_ != nullptr; }
+
+    void Release();
+
+ private:
+    TPooledBuffer(TBufferPool* pool, char* data, size_t size)
+        : pool_(pool), data_(data), size_(size) {}
+
+    friend class TBufferPool;
+
+    TBufferPool* pool_ = nullptr;
+    char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/**
+ * @class TBufferPool
+ * @brief Loop-wide pool of I/O buffers, carved from large slabs in power of two size classes.
+ *
+ * Readers borrow a buffer only while they hold unconsumed data, so idle connections pin
+ * no memory and the working set stays proportional to the data in flight. Every slab is
+ * one mmap, optionally with MAP_HUGETLB (falls back to transparent huge pages when no
+ * huge pages are reserved), and is never unmapped before the pool is destroyed: buffer
+ * addresses stay stable, as io_uring registered or provided buffers require.
+ *
+ * Not thread-safe, a pool belongs to one loop (see TPollerBase::BufferPool()).
+ */
+class TBufferPool {
+ public:
+    struct TOptions {
+        size_t SlabSize = 2 << 20;    // bytes per mmap, a multiple of the huge page size
+        size_t MaxBytes = 0;          // limit of the mapped memory, 0 - no limit
+        bool HugePages = false;       // try MAP_HUGETLB first
+    };
+
+    static constexpr size_t MinBufferSize = 4096;
+    static constexpr size_t MaxBufferSize = 65536;
+
+    TBufferPool();
+    explicit TBufferPool(TOptions options);
+    ~TBufferPool();
+
+    TBufferPool(const TBufferPool&) = delete;
+    TBufferPool& operator=(const TBufferPool&) = delete;
+
+    /**
+     * @brief Borrows a buffer of at least @p size bytes (rounded up to the size class).
+     *
+     * Over the memory limit, or above MaxBufferSize, the buffer comes from the heap and
+     * the Overflows counter is incremented.
+     */
+    TPooledBuffer Acquire(size_t size);
+
+    /**
+     * @brief Applies @p options to the slabs mapped from now on, mapped slabs are kept.
+     *
+     * A MaxBytes below the mapped memory only stops the pool from growing.
+     */
+    void SetOptions(TOptions options);
+
+    /**
+     * @brief Slabs of the pool, e.g. to register them with io_uring.
+     */
+    std::vector<std::span<char>> Slabs() const;
+
+    TBufferPoolStats Stats() const { return stats_; }
+
+ private:
+    struct TFreeBuffer {
+        TFreeBuffer* Next;
+    };
+
+    struct TSlab {
+        char* Data;
+        size_t Size;
+    };
+
+    static constexpr int classes = 5;  // 4KB .. 64KB
+
+    bool Grow(int index);
+    void Release(char* data, size_t size);
+
+    friend class TPooledBuffer;
+
+    TOptions options_;
+    TFreeBuffer* free_[classes] = {};  // released buffers
+    char* bump_[classes] = {};         // not yet handed out part of the last slab of a class
+    char* bump_end_[classes] = {};
+    std::vector<TSlab> slabs_;
+    TBufferPoolStats stats_;
+};
+
+}  // namespace NNet
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "address.h"
+#include "base.h"
+#include "corochain.h"
+#include "poller.h"
+#include "promises.h"
+
+namespace NNet {
+
+/**
+ * @class TConnectionPool
+ * @brief Connected sockets per TAddress reused across requests, owned by one loop.
+ *
+ * Acquire() hands out an idle connection of the address (the most recently released one)
+ * or connects a new one. TConnection::Release() gives it back after a complete exchange,
+ * a connection destroyed without Release() is closed. Idle connections are watched with
+ * Monitor(): closed when the peer closes them or after IdleTimeout, on the poller timers.
+ * At most MaxTotal connections per address are open, Acquire() waits for one to be
+ * released or closed above that. The pool must outlive its connections.
+ *
+ * Example:
+ * @code
+ * TConnectionPool<TSocket> pool(loop.Poller());
+ * auto conn = co_await pool.Acquire(TAddress{"10.0.0.1", 8080});
+ * co_await TByteWriter<TSocket>(conn.Socket()).Write(request.data(), request.size());
+ * co_await TByteReader<TSocket>(conn.Socket()).Read(reply.data(), reply.size());
+ * conn.Release();
+ * @endcode
+ */
+template <typename TSocket>
+class TConnectionPool {
+ public:
+    using TPoller = typename TSocket::TPoller;
+
+    struct TOptions {
+        size_t MaxIdle = 8;    // idle connections kept per address
+        size_t MaxTotal = 64;  // open connections per address, idle and in use
+        std::chrono::milliseconds IdleTimeout{60000};  // 0: idle connections never expire
+    };
+
+    struct TStats {
+        size_t Idle = 0;
+        size_t InUse = 0;
+        uint64_t Connected = 0;     // new connections
+        uint64_t Reused = 0;        // idle connections handed out
+        uint64_t Expired = 0;       // idle connections closed after IdleTimeout
+        uint64_t ClosedByPeer = 0;  // idle connections closed by the remote side
+    };
+
+    /**
+     * @brief A connection lent by the pool, closed on destruction unless released.
+     */
+    class TConnection {
+     public:
+        TConnection() = default;
+
+        TConnection(TConnection&& other) { *this = std::move(other); }
+
+        TConnection& operator=(TConnection&& other) {
+            if (this != &other) {
+                Reset();
+                pool_ = std::exchange(other.pool_, nullptr);
+                addr_ = other.addr_;
+                socket_ = std::move(other.socket_);
+            }
+            return *this;
+        }
+
+        ~TConnection() { Reset(); }
+
+        TSocket& Socket() { return socket_; }
+
+        TSocket* operator->() { return &socket_; }
+
+        const TAddress& Addr() const { return addr_; }
+
+        /**
+         * @brief Returns the connection to the pool, only when no reply is pending on it.
+         */
+        void Release() {
+            if (pool_) {
+                std::exchange(pool_, nullptr)->Put(addr_, std::move(socket_));
+            }
+        }
+
+     private:
+        friend class TConnectionPool;
+
+        TConnection(TConnectionPool* pool, const TAddress& addr, TSocket socket)
+            : pool_(pool), addr_(addr), socket_(std::move(socket)) {}
+
+        void Reset() {
+            if (pool_) {
+                socket_.Close();
+                std::exchange(pool_, nullptr)->Drop(addr_);
+            }
+        }
+
+        TConnectionPool* pool_ = nullptr;
+        TAddress addr_;
+        TSocket socket_;
+    };
+
+    explicit TConnectionPool(TPoller& poller) : TConnectionPool(poller, TOptions()) {}
+
+    TConnectionPool(TPoller& poller, TOptions options) : poller_(poller), options_(options) {}
+
+    TConnectionPool(const TConnectionPool&) = delete;
+    TConnectionPool& operator=(const TConnectionPool&) = delete;
+
+    ~TConnectionPool() {
+        for (auto& [addr, host] : hosts_) {
+            for (auto& idle : host.Idle) {
+                StopWatch(idle);
+                idle.Socket.Close();
+            }
+        }
+    }
+
+    /**
+     * @brief An idle connection to @p addr or a new one, throws TTimeoutError if none is
+     * connected by @p deadline.
+     */
+    TValueTask<TConnection> Acquire(TAddress addr, TTime deadline = TTime::max()) {
+        // the node stays in place while the host has connections or waiters
+        auto& host = hosts_[addr];
+        while (true) {
+            if (!host.Idle.empty()) {
+                co_return Take(addr, host);
+            }
+            if (host.Total < options_.MaxTotal) {
+                ++host.Total;
+                ++stats_.InUse;
+                TSocket socket(poller_, addr.Domain());
+                try {
+                    co_await socket.Connect(addr, deadline);
+                } catch (...) {
+                    socket.Close();
+                    Drop(addr);
+                    throw;
+                }
+                ++stats_.Connected;
+                co_return TConnection(this, addr, std::move(socket));
+            }
+            co_await TSlotWait{this, &host, deadline};
+        }
+    }
+
+    TStats Stats() const { return stats_; }
+
+ private:
+    struct TIdle {
+        TSocket Socket;
+        THandle Watcher = {};  // Watch() waiting in Monitor()
+        bool Taken = false;    // the watcher must leave the connection alone
+    };
+
+    struct TSlotWait;
+
+    struct THost {
+        std::list<TIdle> Idle;  // released last at the back
+        size_t Total = 0;       // open connections, idle and in use
+        std::vector<TSlotWait*> Waiters;  // Acquire() calls above MaxTotal, oldest first
+    };
+
+    using TIdleIt = typename std::list<TIdle>::iterator;
+
+    struct TSlotWait {
+        bool await_ready() { return false; }
+
+        void await_suspend(std::coroutine_handle<> h) {
+            Handle = h;
+            Host->Waiters.push_back(this);
+            if (Deadline != TTime::max()) {
+                Timer = Pool->poller_.AddTimer(Deadline, h);
+            }
+        }
+
+        void await_resume() {
+            std::erase(Host->Waiters, this);
+            if (!Woken) {
+                throw TTimeoutError("Connection pool timeout");
+            }
+        }
+
+        TConnectionPool* Pool;
+        THost* Host;
+        TTime Deadline;
+        THandle Handle = {};
+        TTimerId Timer = 0;
+        bool Woken = false;
+    };
+
+    // the watcher is only ever suspended here, the pool can resume it out of Monitor()
+    template <typename T>
+    struct TTrackedAwaitable : T {
+        void await_suspend(std::coroutine_handle<> h) {
+            T::await_suspend(h);
+            *Handle = h;
+        }
+
+        decltype(auto) await_resume() {
+            *Handle = {};
+            return T::await_resume();
+        }
+
+        THandle* Handle;
+    };
+
+    TConnection Take(const TAddress& addr, THost& host) {
+        auto it = std::prev(host.Idle.end());
+        StopWatch(*it);
+        TConnection conn(this, addr, std::move(it->Socket));
+        host.Idle.erase(it);
+        --stats_.Idle;
+        ++stats_.InUse;
+        ++stats_.Reused;
+        return conn;
+    }
+
+    void Put(const TAddress& addr, TSocket socket) {
+        auto& host = hosts_.find(addr)->second;
+        if (socket.Fd() < 0 || host.Idle.size() >= options_.MaxIdle) {
+            socket.Close();
+            Drop(addr);
+            return;
+        }
+        --stats_.InUse;
+        host.Idle.push_back(TIdle{std::move(socket)});
+        ++stats_.Idle;
+        Watch(addr, &host, std::prev(host.Idle.end()));
+        Wake(host);
+    }
+
+    // a connection in use is closed
+    void Drop(const TAddress& addr) {
+        --stats_.InUse;
+        Closed(addr);
+    }
+
+    // a connection of @p addr is closed, its slot goes to a waiter
+    void Closed(const TAddress& addr) {
+        auto it = hosts_.find(addr);
+        auto& host = it->second;
+        --host.Total;
+        Wake(host);
+        if (host.Total == 0 && host.Waiters.empty()) {
+            hosts_.erase(it);
+        }
+    }
+
+    // the first waiter that is not woken yet retries on the next Poll()
+    void Wake(THost& host) {
+        for (auto* waiter : host.Waiters) {
+            if (!waiter->Woken) {
+                waiter->Woken = true;
+                if (waiter->Timer) {
+                    poller_.RemoveTimer(waiter->Timer);
+                }
+                poller_.AddTimer(TTime{}, waiter->Handle);
+                return;
+            }
+        }
+    }
+
+    TVoidTask Watch(TAddress addr, THost* host, TIdleIt it) {
+        auto deadline = options_.IdleTimeout.count() ? TClock::now() + options_.IdleTimeout
+                                                     : TTime::max();
+        bool expired = false;
+        try {
+            auto op = it->Socket.Monitor(deadline);
+            co_await TTrackedAwaitable<decltype(op)>{op, &it->Watcher};
+        } catch (const TTimeoutError&) {
+            expired = true;
+        }
+        if (it->Taken) {
+            co_return;  // handed out or the pool is destroyed
+        }
+        ++(expired ? stats_.Expired : stats_.ClosedByPeer);
+        it->Socket.Close();
+        host->Idle.erase(it);
+        --stats_.Idle;
+        Closed(addr);
+    }
+
+    // takes the watcher of @p idle out of Monitor() at once, its timer is removed on the way
+    void StopWatch(TIdle& idle) {
+        idle.Taken = true;
+        if (auto watcher = idle.Watcher) {
+            poller_.RemoveWait(idle.Socket.Fd(), TEvent::RHUP, watcher);
+            watcher.resume();
+        }
+    }
+
+    TPoller& poller_;
+    TOptions options_;
+    std::unordered_map<TAddress, THost> hosts_;
+    TStats stats_;
+};
+
+}  // namespace NNet
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <coroutine>
 #include <optional>
 #include <variant>
@@ -16,7 +17,7 @@ template <typename T>
 struct TValueTask;
 
 template <typename T>
-struct TValuePromiseBase {
+struct TValuePromiseBase : TPooledFrame {
     std::suspend_never initial_suspend() { return {}; }
     TFinalAwaiter<T> final_suspend() noexcept;
     std::coroutine_handle<> Caller = std::noop_coroutine();
@@ -0,0 +1,113 @@
+#include <netinet/udp.h>
+#include <cstring>
+#include "datagram.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+namespace NNet {
+
+namespace {
+
+// room for one UDP_SEGMENT (uint16_t) or UDP_GRO (int) control message
+constexpr size_t control_size = CMSG_SPACE(sizeof(int));
+
+}  // namespace
+
+void TDatagramSocket::Bind(const TAddress& addr) {
+    auto [rawaddr, len] = addr.RawAddr();
+    if (bind(fd_, rawaddr, len) < 0) {
+        throw std::system_error(errno, std::generic_category(), "bind");
+    }
+}
+
+bool TDatagramSocket::EnableGro() {
+    int optval = 1;
+    if (setsockopt(fd_, IPPROTO_UDP, UDP_GRO, &optval, sizeof(optval)) < 0) {
+        if (errno == ENOPROTOOPT) {
+            return false;
+        }
+        throw std::system_error(errno, std::generic_category(), "setsockopt UDP_GRO");
+    }
+    return true;
+}
+
+void TDatagramSocket::TBatchBuffers::Prepare(size_t count) {
+    if (Headers.size() < count) {
+        Headers.resize(count);
+        Iov.resize(count);
+        Addrs.resize(count);
+        Control.resize(count * control_size);
+    }
+}
+
+int TDatagramSocket::TryRecvBatch(std::span<TDatagram> batch) {
+    if (!recv_) {
+        recv_ = std::make_unique<TBatchBuffers>();
+    }
+    auto& buffers = *recv_;
+    buffers.Prepare(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        buffers.Iov[i] = {batch[i].Data, batch[i].Size};
+        auto& hdr = buffers.Headers[i].msg_hdr;
+        hdr = {};
+        hdr.msg_name = &buffers.Addrs[i];
+        hdr.msg_namelen = sizeof(sockaddr_in6);
+        hdr.msg_iov = &buffers.Iov[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = &buffers.Control[i * control_size];
+        hdr.msg_controllen = control_size;
+    }
+    int count = recvmmsg(fd_, buffers.Headers.data(), batch.size(), MSG_DONTWAIT, nullptr);
+    for (int i = 0; i < count; ++i) {
+        auto& hdr = buffers.Headers[i].msg_hdr;
+        batch[i].Size = buffers.Headers[i].msg_len;
+        batch[i].Addr = TAddress{reinterpret_cast<sockaddr*>(hdr.msg_name), hdr.msg_namelen};
+        batch[i].SegmentSize = 0;
+        for (auto* cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+            if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int segment;
+                memcpy(&segment, CMSG_DATA(cmsg), sizeof(segment));
+                batch[i].SegmentSize = segment;
+            }
+        }
+    }
+    return count;
+}
+
+int TDatagramSocket::TrySendBatch(std::span<const TDatagram> batch) {
+    if (!send_) {
+        send_ = std::make_unique<TBatchBuffers>();
+    }
+    auto& buffers = *send_;
+    buffers.Prepare(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        buffers.Iov[i] = {batch[i].Data, batch[i].Size};
+        auto& hdr = buffers.Headers[i].msg_hdr;
+        hdr = {};
+        auto [rawaddr, len] = batch[i].Addr.RawAddr();
+        hdr.msg_name = const_cast<sockaddr*>(rawaddr);
+        hdr.msg_namelen = len;
+        hdr.msg_iov = &buffers.Iov[i];
+        hdr.msg_iovlen = 1;
+        if (batch[i].SegmentSize) {
+            char* control = &buffers.Control[i * control_size];
+            memset(control, 0, control_size);
+            hdr.msg_control = control;
+            hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            auto* cmsg = CMSG_FIRSTHDR(&hdr);
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segment = batch[i].SegmentSize;
+            memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+        }
+    }
+    return sendmmsg(fd_, buffers.Headers.data(), batch.size(), MSG_DONTWAIT);
+}
+
+}  // namespace NNet
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "address.h"
+#include "socket.h"
+
+namespace NNet {
+
+/**
+ * @brief One datagram of a RecvBatch()/SendBatch() call.
+ *
+ * For RecvBatch() Data/Size is the buffer, on return Size is the received length, Addr the
+ * sender and SegmentSize the size of the coalesced segments when UDP_GRO merged several
+ * datagrams (0 otherwise). For SendBatch() a non-zero SegmentSize lets the kernel split Data
+ * into datagrams of that size (UDP_SEGMENT, GSO), only the last one may be shorter.
+ */
+struct TDatagram {
+    void* Data = nullptr;
+    size_t Size = 0;
+    TAddress Addr;
+    uint16_t SegmentSize = 0;
+};
+
+/**
+ * @class TDatagramSocket
+ * @brief UDP socket with per-datagram and batched (recvmmsg/sendmmsg) awaitables.
+ *
+ * As with the stream awaitables a result of -1 means a spurious wakeup, the caller retries.
+ * Only one RecvBatch() and one SendBatch() may be in flight at a time, they reuse the
+ * message headers kept by the socket.
+ *
+ * Example:
+ * @code
+ * std::vector<TDatagram> batch(32, TDatagram{...});
+ * int n = co_await socket.RecvBatch(batch);
+ * @endcode
+ */
+class TDatagramSocket : public TSocketBase<TSockOps> {
+ public:
+    struct TRecvResult {
+        int Size;  // -1 if there was nothing to receive
+        TAddress From;
+    };
+
+    TDatagramSocket() = default;
+
+    TDatagramSocket(TPollerBase& poller, int domain) : TSocketBase(poller, domain, SOCK_DGRAM) {}
+
+    TDatagramSocket(TDatagramSocket&& other) { *this = std::move(other); }
+
+    TDatagramSocket& operator=(TDatagramSocket&& other) {
+        if (this != &other) {
+            Close();
+            poller_ = other.poller_;
+            fd_ = other.fd_;
+            other.fd_ = -1;
+            recv_ = std::move(other.recv_);
+            send_ = std::move(other.send_);
+        }
+        return *this;
+    }
+
+    void Bind(const TAddress& addr);
+
+    /**
+     * @brief Enables UDP_GRO: the kernel may merge datagrams of one flow into one buffer.
+     *
+     * @return false if the kernel does not support it.
+     */
+    bool EnableGro();
+
+    auto RecvFrom(void* buf, size_t size) {
+        struct TAwaitableRecv : TAwaitable<TAwaitableRecv> {
+            void run() {
+                len = sizeof(addr);
+                this->ret = recvfrom(this->fd, this->b, this->s, 0,
+                                     reinterpret_cast<sockaddr*>(&addr), &len);
+                TN_TRACE(this->poller->Trace(), Debug, SocketRead, this->fd, this->ret);
+                this->poller->Metrics().CountRead(this->ret);
+            }
+
+            void await_suspend(std::coroutine_handle<> h) { this->poller->AddRead(this->fd, h); }
+
+            TRecvResult await_resume() {
+                int size = TAwaitable<TAwaitableRecv>::await_resume();
+                if (size < 0) {
+                    return {size, {}};
+                }
+                return {size, TAddress{reinterpret_cast<sockaddr*>(&addr), len}};
+            }
+
+            sockaddr_in6 addr{};
+            socklen_t len = 0;
+        };
+        return TAwaitableRecv{{poller_, fd_, buf, size}};
+    }
+
+    auto SendTo(const void* buf, size_t size, const TAddress& to) {
+        struct TAwaitableSend : TAwaitable<TAwaitableSend> {
+            void run() {
+                this->ret = sendto(this->fd, this->b, this->s, 0, addr.first, addr.second);
+                TN_TRACE(this->poller->Trace(), Debug, SocketWrite, this->fd, this->ret);
+                this->poller->Metrics().CountWrite(this->ret);
+            }
+
+            void await_suspend(std::coroutine_handle<> h) { this->poller->AddWrite(this->fd, h); }
+
+            std::pair<const sockaddr*, int> addr;
+        };
+        return TAwaitableSend{{poller_, fd_, const_cast<void*>(buf), size}, to.RawAddr()};
+    }
+
+    /**
+     * @brief Receives up to batch.size() datagrams with one recvmmsg(), returns their number.
+     */
+    auto RecvBatch(std::span<TDatagram> batch) {
+        struct TAwaitableRecv : TAwaitable<TAwaitableRecv> {
+            void run() {
+                this->ret = socket->TryRecvBatch(batch);
+                TN_TRACE(this->poller->Trace(), Debug, SocketRead, this->fd, this->ret);
+                this->poller->Metrics().CountRead(BatchBytes(batch, this->ret));
+            }
+
+            void await_suspend(std::coroutine_handle<> h) { this->poller->AddRead(this->fd, h); }
+
+            TDatagramSocket* socket;
+            std::span<TDatagram> batch;
+        };
+        return TAwaitableRecv{{poller_, fd_}, this, batch};
+    }
+
+    /**
+     * @brief Sends the datagrams of @p batch with one sendmmsg(), returns how many were sent.
+     *
+     * Fewer than batch.size() may be sent, the caller sends the rest again.
+     */
+    auto SendBatch(std::span<const TDatagram> batch) {
+        struct TAwaitableSend : TAwaitable<TAwaitableSend> {
+            void run() {
+                this->ret = socket->TrySendBatch(batch);
+                TN_TRACE(this->poller->Trace(), Debug, SocketWrite, this->fd, this->ret);
+                this->poller->Metrics().CountWrite(BatchBytes(batch, this->ret));
+            }
+
+            void await_suspend(std::coroutine_handle<> h) { this->poller->AddWrite(this->fd, h); }
+
+            TDatagramSocket* socket;
+            std::span<const TDatagram> batch;
+        };
+        return TAwaitableSend{{poller_, fd_}, this, batch};
+    }
+
+ private:
+    // payload bytes of the first @p count datagrams, -1 if the call failed
+    static ssize_t BatchBytes(std::span<const TDatagram> batch, int count) {
+        if (count < 0) {
+            return count;
+        }
+        ssize_t bytes = 0;
+        for (int i = 0; i < count; ++i) {
+            bytes += batch[i].Size;
+        }
+        return bytes;
+    }
+
+    // message headers of a batch, kept between calls
+    struct TBatchBuffers {
+        std::vector<mmsghdr> Headers;
+        std::vector<iovec> Iov;
+        std::vector<sockaddr_in6> Addrs;
+        std::vector<char> Control;
+
+        void Prepare(size_t count);
+    };
+
+    int TryRecvBatch(std::span<TDatagram> batch);
+    int TrySendBatch(std::span<const TDatagram> batch);
+
+    std::unique_ptr<TBatchBuffers> recv_;
+    std::unique_ptr<TBatchBuffers> send_;
+};
+
+}  // namespace NNet
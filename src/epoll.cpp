@@ -1,4 +1,10 @@
 #include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <csignal>
+#include <stdexcept>
+#include <system_error>
 #include "epoll.h"
 
 namespace NNet {
@@ -10,36 +16,159 @@ TEpoll::TEpoll() : fd_(epoll_create1(epoll_flags)) {
     if (fd_ == invalid_handle) {
         throw std::runtime_error("epoll_create1 failed");
     }
+    epoll_event eev = {};
+    eev.events = EPOLLIN;
+    eev.data.fd = wake_fd_;
+    if (epoll_ctl(fd_, EPOLL_CTL_ADD, wake_fd_, &eev) < 0) {
+        int err = errno;
+        close(fd_);
+        throw std::system_error(err, std::generic_category(), "epoll_ctl wake fd");
+    }
 }
 
 TEpoll::~TEpoll() {
+    if (timer_fd_ != invalid_handle) {
+        close(timer_fd_);
+    }
     if (fd_ != invalid_handle) {
         close(fd_);
     }
 }
 
-void TEpoll::Poll() {
-    std::cout << "Epoll::polling..." << std::endl;
-    std::cout << "in_events_.size: " << in_events_.size() << std::endl;
-    std::cout << "out_events_.size: " << out_events_.size() << std::endl;
-    auto ts = GetTimeout();
-    std::cout << "poll timeout: " << ts.tv_sec << "s," << ts.tv_nsec / 1e6 << "ms" << std::endl;
-    std::cout << "max_fd_: " << max_fd_ << std::endl;
-    if (static_cast<int>(in_events_.size()) <= max_fd_) {
-        in_events_.resize(max_fd_ + 1);
+void TEpoll::SetExclusive(int fd) {
+    if (static_cast<int>(exclusive_.size()) <= fd) {
+        exclusive_.resize(fd + 1);
+    }
+    exclusive_[fd] = true;
+}
+
+void TEpoll::SetEdgeTriggered(bool enable) {
+    if (registered_) {
+        throw std::logic_error("edge-triggered mode must be set before any fd is registered");
+    }
+    edge_triggered_ = enable;
+    disarm_on_wakeup_ = !enable;
+}
+
+void TEpoll::ApplyEdgeChanges() {
+    if (edge_.size() < in_events_.size()) {
+        edge_.resize(in_events_.size());
+    }
+    for (const auto &ch : changes_) {
+        int fd = ch.Fd;
+        TN_TRACE(trace_, Debug, PollChange, fd, ch.Type, !!ch.Handle);
+        auto &ev = in_events_[fd];
+        auto &state = edge_[fd];
+        bool exclusive = fd < static_cast<int>(exclusive_.size()) && exclusive_[fd];
+        if (!ch.Handle) {
+            if (ch.Type == (TEvent::READ | TEvent::WRITE | TEvent::RHUP | TEvent::ERR)) {
+                // RemoveEvent: the descriptor is closed or handed over, forget it
+                if (state.Registered) {
+                    TN_TRACE(trace_, Debug, EpollCtl, fd, EPOLL_CTL_DEL, 0);
+                    if (epoll_ctl(fd_, EPOLL_CTL_DEL, fd, nullptr) == 0) {
+                        metrics_.EpollCtlDel.Add();
+                    } else if (!(errno == EBADF || errno == ENOENT)) {
+                        throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+                    }
+                }
+                ev = {};
+                state = {};
+                if (exclusive) {
+                    exclusive_[fd] = false;
+                }
+            } else {
+                // an awaiter is gone, the registration stays
+                if (ch.Type & TEvent::READ) {
+                    ev.Read = {};
+                }
+                if (ch.Type & TEvent::WRITE) {
+                    ev.Write = {};
+                }
+                if (ch.Type & TEvent::RHUP) {
+                    ev.RHup = {};
+                }
+                if (ch.Type & TEvent::ERR) {
+                    ev.Err = {};
+                }
+            }
+            continue;
+        }
+
+        if (!state.Registered) {
+            epoll_event eev = {};
+            eev.data.fd = fd;
+            // EPOLLEXCLUSIVE does not allow EPOLLRDHUP, a hang up still comes as EPOLLIN
+            eev.events = exclusive ? EPOLLIN | EPOLLOUT | EPOLLET | EPOLLEXCLUSIVE
+                                   : EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            TN_TRACE(trace_, Debug, EpollCtl, fd, EPOLL_CTL_ADD, eev.events);
+            if (epoll_ctl(fd_, EPOLL_CTL_ADD, fd, &eev) < 0) {
+                throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+            }
+            metrics_.EpollCtlAdd.Add();
+            state.Registered = true;
+            registered_ = true;
+        }
+
+        auto arm = [&](int type, THandle &handle) {
+            if (!(ch.Type & type)) {
+                return;
+            }
+            if (state.Ready & type) {
+                // the edge came while nobody waited, it may be stale: the awaiter retries on EAGAIN
+                state.Ready &= ~type;
+                handle = {};
+                cached_ready_.emplace_back(TEvent{fd, type, ch.Handle});
+            } else {
+                handle = ch.Handle;
+            }
+        };
+        arm(TEvent::READ, ev.Read);
+        arm(TEvent::WRITE, ev.Write);
+        arm(TEvent::RHUP, ev.RHup);
+        arm(TEvent::ERR, ev.Err);
+    }
+}
+
+void TEpoll::DispatchEdge(int fd, uint32_t events) {
+    if (fd >= static_cast<int>(edge_.size())) {
+        return;
     }
+    auto &ev = in_events_[fd];
+    auto &state = edge_[fd];
+    auto fire = [&](int type, THandle &handle) {
+        if (handle) {
+            ready_events_.emplace_back(TEvent{fd, type, handle});
+            handle = {};
+        } else {
+            state.Ready |= type;
+        }
+    };
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        fire(TEvent::READ, ev.Read);
+    }
+    if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+        fire(TEvent::WRITE, ev.Write);
+    }
+    if (events & (EPOLLRDHUP | EPOLLHUP)) {
+        fire(TEvent::RHUP, ev.RHup);
+    }
+    if (events & EPOLLERR) {
+        fire(TEvent::ERR, ev.Err);
+    }
+}
 
+void TEpoll::ApplyChanges() {
     for (const auto &ch : changes_) {
         int fd = ch.Fd;
-        std::cout << "current fd: " << fd << ", type: " << ch.Type << std::endl;
+        TN_TRACE(trace_, Debug, PollChange, fd, ch.Type, !!ch.Handle);
         auto &ev = in_events_[fd];
         epoll_event eev = {};
         eev.data.fd = fd;
         bool change = false;
         bool new_ev = false;
         if (ch.Handle) {
-            std::cout << "fd: " << fd << ", has handle" << std::endl;
-            new_ev = !!ev.Read && !!ev.Write && !!ev.RHup;
+            // no handle yet: the descriptor is not registered, handles are kept until removed
+            new_ev = !ev.Read && !ev.Write && !ev.RHup && !ev.Err;
             if (ch.Type & TEvent::READ) {
                 eev.events |= EPOLLIN;
                 change |= ev.Read != ch.Handle;
@@ -55,8 +184,13 @@ void TEpoll::Poll() {
                 change |= ev.RHup != ch.Handle;
                 ev.RHup = ch.Handle;
             }
+            if (ch.Type & TEvent::ERR) {
+                // always reported by epoll, set to keep the descriptor registered
+                eev.events |= EPOLLERR;
+                change |= ev.Err != ch.Handle;
+                ev.Err = ch.Handle;
+            }
         } else {
-            std::cout << "fd: " << fd << ", no handle" << std::endl;
             if (ch.Type & TEvent::READ) {
                 change |= !!ev.Read;
                 ev.Read = {};
@@ -65,6 +199,14 @@ void TEpoll::Poll() {
                 change |= !!ev.Write;
                 ev.Write = {};
             }
+            if (ch.Type & TEvent::RHUP) {
+                change |= !!ev.RHup;
+                ev.RHup = {};
+            }
+            if (ch.Type & TEvent::ERR) {
+                change |= !!ev.Err;
+                ev.Err = {};
+            }
             if (ev.Read) {
                 eev.events |= EPOLLIN;
             }
@@ -74,63 +216,171 @@ void TEpoll::Poll() {
             if (ev.RHup) {
                 eev.events |= EPOLLRDHUP;
             }
+            if (ev.Err) {
+                eev.events |= EPOLLERR;
+            }
         }
-        std::cout << "fd: " << fd << ", is new_ev: " << new_ev << ", changd? " << change
-                  << std::endl;
-        if (new_ev) {
-            std::cout << "epoll_ctl add: " << fd << std::endl;
-            if (epoll_ctl(fd_, EPOLL_CTL_ADD, fd, &eev) < 0) {
-                throw std::runtime_error("epoll_ctl failed");
+        bool exclusive = fd < static_cast<int>(exclusive_.size()) && exclusive_[fd];
+        if (exclusive && !ch.Handle &&
+            ch.Type == (TEvent::READ | TEvent::WRITE | TEvent::RHUP | TEvent::ERR)) {
+            exclusive_[fd] = false;  // RemoveEvent: the fd may be reused by another socket
+        }
+        if (exclusive && eev.events) {
+            // EPOLLEXCLUSIVE registrations support only ADD and DEL
+            if (change) {
+                eev.events |= EPOLLEXCLUSIVE;
+                TN_TRACE(trace_, Debug, EpollCtl, fd, EPOLL_CTL_ADD, eev.events);
+                if (epoll_ctl(fd_, EPOLL_CTL_ADD, fd, &eev) == 0) {
+                    metrics_.EpollCtlAdd.Add();
+                } else if (errno != EEXIST) {
+                    throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+                }
+                registered_ = true;
             }
-        } else if (!eev.events) {
-            std::cout << "epoll_ctl del: " << fd << std::endl;
-            if (epoll_ctl(fd_, EPOLL_CTL_DEL, fd, nullptr) < 0) {
-                if (!(errno == EBADF ||
-                      errno == ENOENT)) {  // closed descriptor after TSocket -> close
+        } else if (new_ev) {
+            TN_TRACE(trace_, Debug, EpollCtl, fd, EPOLL_CTL_ADD, eev.events);
+            if (epoll_ctl(fd_, EPOLL_CTL_ADD, fd, &eev) == 0) {
+                metrics_.EpollCtlAdd.Add();
+            } else if (errno == EEXIST) {
+                // still registered in the kernel, update it instead
+                if (epoll_ctl(fd_, EPOLL_CTL_MOD, fd, &eev) < 0) {
                     throw std::system_error(errno, std::generic_category(), "epoll_ctl");
                 }
+                metrics_.EpollCtlMod.Add();
+            } else {
+                throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+            }
+            registered_ = true;
+        } else if (!eev.events) {
+            TN_TRACE(trace_, Debug, EpollCtl, fd, EPOLL_CTL_DEL, 0);
+            if (epoll_ctl(fd_, EPOLL_CTL_DEL, fd, nullptr) == 0) {
+                metrics_.EpollCtlDel.Add();
+            } else if (!(errno == EBADF ||
+                         errno == ENOENT)) {  // closed descriptor after TSocket -> close
+                throw std::system_error(errno, std::generic_category(), "epoll_ctl");
             }
         } else if (change) {
-            std::cout << "epoll_ctl mod: " << fd << std::endl;
-            if (epoll_ctl(fd_, EPOLL_CTL_MOD, fd, &eev) < 0) {
-                if (errno == ENOENT) {
-                    if (epoll_ctl(fd_, EPOLL_CTL_ADD, fd, &eev) < 0) {
-                        throw std::system_error(errno, std::generic_category(), "epoll_ctl");
-                    }
-                } else {
+            TN_TRACE(trace_, Debug, EpollCtl, fd, EPOLL_CTL_MOD, eev.events);
+            if (epoll_ctl(fd_, EPOLL_CTL_MOD, fd, &eev) == 0) {
+                metrics_.EpollCtlMod.Add();
+            } else if (errno == ENOENT) {
+                // closed and reused before its handles were removed, the kernel forgot it
+                if (epoll_ctl(fd_, EPOLL_CTL_ADD, fd, &eev) < 0) {
                     throw std::system_error(errno, std::generic_category(), "epoll_ctl");
                 }
+                metrics_.EpollCtlAdd.Add();
+                registered_ = true;
+            } else {
+                throw std::system_error(errno, std::generic_category(), "epoll_ctl");
             }
         }
     }
+}
+
+int TEpoll::Wait(const timespec &ts) {
+#ifdef SYS_epoll_pwait2
+    if (has_pwait2_) {
+        // called directly, the glibc wrapper needs 2.35
+        int nfds = syscall(SYS_epoll_pwait2, fd_, &out_events_[0], out_events_.size(), &ts,
+                           nullptr, _NSIG / 8);
+        if (nfds >= 0 || errno != ENOSYS) {
+            return nfds;
+        }
+        has_pwait2_ = false;
+    }
+#endif
+    if (ts.tv_nsec % 1000000 == 0) {
+        // whole milliseconds (or zero), epoll_pwait is exact enough
+        int timeout = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+        return epoll_pwait(fd_, &out_events_[0], out_events_.size(), timeout, nullptr);
+    }
+    return WaitTimerFd(ts);
+}
+
+int TEpoll::WaitTimerFd(const timespec &ts) {
+    if (timer_fd_ == invalid_handle) {
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "timerfd_create");
+        }
+        epoll_event eev = {};
+        eev.events = EPOLLIN;
+        eev.data.fd = timer_fd_;
+        if (epoll_ctl(fd_, EPOLL_CTL_ADD, timer_fd_, &eev) < 0) {
+            throw std::system_error(errno, std::generic_category(), "epoll_ctl timer fd");
+        }
+    }
+    itimerspec spec = {};
+    spec.it_value = ts;
+    if (timerfd_settime(timer_fd_, 0, &spec, nullptr) < 0) {
+        throw std::system_error(errno, std::generic_category(), "timerfd_settime");
+    }
+    return epoll_pwait(fd_, &out_events_[0], out_events_.size(), -1, nullptr);
+}
+
+void TEpoll::Poll() {
+    auto ts = GetTimeout();
+    TN_TRACE(trace_, Debug, PollBegin, changes_.size(), max_fd_,
+             ts.tv_sec * 1000000000LL + ts.tv_nsec);
+    if (static_cast<int>(in_events_.size()) <= max_fd_) {
+        in_events_.resize(max_fd_ + 1);
+    }
+
+    metrics_.ChangesPerPoll.Record(changes_.size());
+    if (edge_triggered_) {
+        ApplyEdgeChanges();
+    } else {
+        ApplyChanges();
+    }
 
     Reset();
-    std::cout << "changes size: " << changes_.size() << std::endl;
-    std::cout << "ready size: " << ready_events_.size() << std::endl;
+    // readiness cached by the edge-triggered mode is dispatched without waiting
+    ready_events_.swap(cached_ready_);
     out_events_.resize(std::max<size_t>(1, in_events_.size()));
-    std::cout << "in_events_.size: " << in_events_.size() << std::endl;
-    std::cout << "out_events_.size: " << out_events_.size() << std::endl;
 
+    if (!ready_events_.empty()) {
+        ts = {};
+    }
+    auto waitStart = BeginWait();
     int nfds;
-    // if ((nfds = epoll_pwait2(fd_, &out_events_[0], out_events_.size(), &ts, nullptr)) < 0) {
-    //     if (errno == EINTR) {
-    //         return;
-    //     }
-    //     throw std::system_error(errno, std::generic_category(), "epoll_pwait");
-    // }
-
-    if ((nfds = epoll_pwait(fd_, &out_events_[0], out_events_.size(), 100, nullptr)) < 0) {
+    if (BusyPolling() && (ts.tv_sec || ts.tv_nsec)) {
+        nfds = Spin([this] { return Wait(timespec{}); });
+        if (nfds == 0) {
+            nfds = Wait(GetTimeout());  // the spin may have run up to a timer deadline
+            AdaptBusyPoll(TClock::now() - waitStart, nfds > 0);
+        }
+    } else {
+        nfds = Wait(ts);
+    }
+    EndWait(waitStart);
+    if (nfds < 0) {
         if (errno == EINTR) {
             return;
         }
         throw std::system_error(errno, std::generic_category(), "epoll_pwait");
     }
 
-    std::cout << "epoll_pwait done, nfds size: " << nfds << std::endl;
+    TN_TRACE(trace_, Debug, PollWait, nfds, ready_events_.size());
+    metrics_.EventsPerPoll.Record(nfds);
 
     for (int i = 0; i < nfds; ++i) {
         int fd = out_events_[i].data.fd;
-        std::cout << "fd: " << fd << ", events: " << out_events_[i].events << std::endl;
+        TN_TRACE(trace_, Debug, PollEvent, fd, out_events_[i].events);
+        if (fd == wake_fd_) {
+            ConsumeWake();
+            continue;
+        }
+        if (fd == timer_fd_) {
+            // level-triggered: drained here, waits in whole milliseconds do not re-arm it
+            uint64_t expirations;
+            while (read(timer_fd_, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {
+            }
+            continue;
+        }
+        if (edge_triggered_) {
+            DispatchEdge(fd, out_events_[i].events);
+            continue;
+        }
         auto ev = in_events_[fd];
         if (out_events_[i].events & EPOLLIN) {
             ready_events_.emplace_back(TEvent{fd, TEvent::READ, ev.Read});
@@ -159,9 +409,14 @@ void TEpoll::Poll() {
                 ready_events_.emplace_back(TEvent{fd, TEvent::RHUP, ev.RHup});
             }
         }
+        if ((out_events_[i].events & EPOLLERR) && ev.Err) {
+            ready_events_.emplace_back(TEvent{fd, TEvent::ERR, ev.Err});
+        }
     }
 
+    ProcessRemote();
     ProcessTimers();
+    metrics_.ReadyPerPoll.Record(ready_events_.size());
 }
 
 }  // namespace NNet
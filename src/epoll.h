@@ -18,10 +18,52 @@ class TEpoll : public TPollerBase {
 
     void Poll();
 
+    /**
+     * @brief Registers @p fd with EPOLLEXCLUSIVE, for a listener shared by several loops.
+     *
+     * The kernel wakes only one of the epoll instances waiting on the descriptor.
+     * Such a registration cannot be modified, so the descriptor may only be waited
+     * for reading (e.g. Accept). The flag is dropped when the descriptor is removed.
+     */
+    void SetExclusive(int fd);
+
+    /**
+     * @brief Switches to edge-triggered mode, only before any fd is registered.
+     *
+     * A descriptor is registered once with EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET on its first
+     * wait and stays registered until RemoveEvent() (Close()), so there is no epoll_ctl per
+     * operation and no disarm scan after a wakeup. An edge that comes while nobody waits is
+     * cached and handed to the next awaiter of that kind without waiting. The cached
+     * readiness may be stale: the awaiter gets -1 (EAGAIN) and retries, as after any
+     * spurious wakeup. This is what makes ReadSomeYield()/WriteSomeYield() and Monitor(),
+     * which wait without trying first, work in this mode.
+     */
+    void SetEdgeTriggered(bool enable = true);
+
+    bool EdgeTriggered() const { return edge_triggered_; }
+
  private:
+    struct TEdgeState {
+        bool Registered = false;
+        uint8_t Ready = 0;  // TEvent types signalled while nobody waited
+    };
+
+    void ApplyChanges();
+    void ApplyEdgeChanges();
+    void DispatchEdge(int fd, uint32_t events);
+    int Wait(const timespec& ts);
+    int WaitTimerFd(const timespec& ts);
+
     int fd_;
+    bool has_pwait2_ = true;  // cleared when the kernel has no epoll_pwait2 (before 5.11)
+    int timer_fd_ = -1;       // sub-millisecond timeouts without epoll_pwait2, created lazily
+    bool edge_triggered_ = false;
+    bool registered_ = false;  // some fd was registered, the mode cannot change anymore
 
     std::vector<THandlePair> in_events_;
+    std::vector<bool> exclusive_;  // fds registered with EPOLLEXCLUSIVE
+    std::vector<TEdgeState> edge_;       // per fd state of the edge-triggered mode
+    std::vector<TEvent> cached_ready_;   // awaiters served from cached readiness
     std::vector<epoll_event> out_events_;
 };
 }  // namespace NNet
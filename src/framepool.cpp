@@ -0,0 +1,131 @@
+#include <new>
+#include "framepool.h"
+
+namespace NNet {
+
+namespace {
+
+constexpr size_t small_step = 64;
+constexpr size_t small_limit = 1024;  // 16 classes of 64 byte steps
+constexpr size_t large_limit = 65536;  // then 6 power of two classes
+constexpr int classes = small_limit / small_step + 6;
+constexpr size_t max_cached = 256;  // frames per class
+
+struct TFreeFrame {
+    TFreeFrame* Next;
+};
+
+// trivially destructible, so it stays usable by the thread_local destructors that run after
+// the guard below
+struct TFrameCache {
+    void Trim() {
+        for (auto& head : Heads) {
+            while (head) {
+                auto* next = head->Next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+        for (auto& count : Counts) {
+            count = 0;
+        }
+        Stats.Cached = 0;
+    }
+
+    TFreeFrame* Heads[classes] = {};
+    size_t Counts[classes] = {};
+    TFramePoolStats Stats;
+    bool Enabled = true;
+    bool Guarded = false;  // exit_guard is constructed
+};
+
+thread_local TFrameCache cache;
+thread_local bool exited = false;  // frames freed after the guard go straight to operator delete
+
+// trims the cache at thread exit, constructed when the first frame is cached
+struct TExitGuard {
+    ~TExitGuard() {
+        cache.Trim();
+        exited = true;
+    }
+};
+
+thread_local TExitGuard exit_guard;
+
+[[gnu::noinline]] void Guard(TFrameCache& p) {
+    p.Guarded = true;
+    (void)&exit_guard;  // the odr-use constructs it and registers its destructor
+}
+
+int ClassOf(size_t size) {
+    if (size <= small_limit) {
+        return size == 0 ? 0 : (size - 1) / small_step;
+    }
+    if (size > large_limit) {
+        return -1;
+    }
+    int index = small_limit / small_step;
+    for (size_t classSize = small_limit * 2; classSize < size; classSize *= 2) {
+        ++index;
+    }
+    return index;
+}
+
+size_t ClassSize(int index) {
+    constexpr int small_classes = small_limit / small_step;
+    return index < small_classes ? (index + 1) * small_step
+                                 : small_limit << (index - small_classes + 1);
+}
+
+}  // namespace
+
+void* TFramePool::Allocate(size_t size) {
+    auto& p = cache;
+    ++p.Stats.Allocations;
+    int index = ClassOf(size);
+    if (index < 0) {
+        ++p.Stats.Mallocs;
+        return ::operator new(size);
+    }
+    if (p.Enabled && !exited && p.Heads[index]) {
+        auto* frame = p.Heads[index];
+        p.Heads[index] = frame->Next;
+        --p.Counts[index];
+        --p.Stats.Cached;
+        return frame;
+    }
+    ++p.Stats.Mallocs;
+    // the full class size: the frame may be cached later even if the pool is off now
+    return ::operator new(ClassSize(index));
+}
+
+void TFramePool::Deallocate(void* ptr, size_t size) noexcept {
+    auto& p = cache;
+    ++p.Stats.Deallocations;
+    int index = ClassOf(size);
+    if (index < 0 || !p.Enabled || exited || p.Counts[index] >= max_cached) {
+        ::operator delete(ptr);
+        return;
+    }
+    if (!p.Guarded) {
+        Guard(p);
+    }
+    auto* frame = static_cast<TFreeFrame*>(ptr);
+    frame->Next = p.Heads[index];
+    p.Heads[index] = frame;
+    ++p.Counts[index];
+    ++p.Stats.Cached;
+}
+
+void TFramePool::SetEnabled(bool enabled) {
+    cache.Enabled = enabled;
+    if (!enabled) {
+        cache.Trim();
+    }
+}
+
+TFramePoolStats TFramePool::Stats() { return cache.Stats; }
+
+void TFramePool::Trim() { cache.Trim(); }
+
+}  // namespace NNet
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace NNet {
+
+struct TFramePoolStats {
+    uint64_t Allocations = 0;    // frames handed out
+    uint64_t Deallocations = 0;  // frames given back
+    uint64_t Mallocs = 0;        // frames that had to come from operator new
+    uint64_t Cached = 0;         // free frames kept by this thread
+};
+
+/**
+ * @class TFramePool
+ * @brief Per-thread size-class free lists for coroutine frames.
+ *
+ * The promises of TVoidTask and TValueTask allocate their frames here, so once a
+ * thread has warmed up, spawning and finishing coroutines does not call malloc.
+ * Frames are rounded up to a size class (64 byte steps up to 1KB, powers of two up
+ * to 64KB), larger frames go straight to operator new. A frame freed on another
+ * thread (after ResumeOn()) joins the free list of that thread. Every list keeps at
+ * most a fixed number of frames, the rest is returned to operator delete.
+ *
+ * The pool is compiled out with TINYNET_NO_FRAME_POOL, or bypassed per thread with
+ * SetEnabled(false).
+ */
+class TFramePool {
+ public:
+    static void* Allocate(size_t size);
+    static void Deallocate(void* ptr, size_t size) noexcept;
+
+    /**
+     * @brief Turns the pool of the calling thread on or off, frames go to operator new when off.
+     */
+    static void SetEnabled(bool enabled);
+
+    /**
+     * @brief Counters of the calling thread.
+     */
+    static TFramePoolStats Stats();
+
+    /**
+     * @brief Returns the free frames of the calling thread to operator delete.
+     */
+    static void Trim();
+};
+
+/**
+ * @brief Base of the promises whose frames come from TFramePool.
+ */
+struct TPooledFrame {
+#ifndef TINYNET_NO_FRAME_POOL
+    static void* operator new(size_t size) { return TFramePool::Allocate(size); }
+    static void operator delete(void* ptr, size_t size) noexcept {
+        TFramePool::Deallocate(ptr, size);
+    }
+#endif
+};
+
+}  // namespace NNet
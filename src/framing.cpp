@@ -0,0 +1,132 @@
+#include <string.h>
+#include "framing.h"
+
+namespace NNet {
+
+TFrameSplitter::TFrameSplitter(EFramePrefix prefix, size_t maxFrameSize, TBufferPool* pool)
+    : Prefix(prefix), MaxFrameSize(maxFrameSize), WPos(0), RPos(0), Size(0),
+      Cap(maxFrameSize * 2), Pool(pool) {
+    if (maxFrameSize < MaxPrefixSize || maxFrameSize > UINT32_MAX) {
+        throw std::invalid_argument("Max frame size must be between 5 bytes and 4GB");
+    }
+    if (!Pool) {
+        Data.resize(Cap);
+        View = Data;
+    }
+}
+
+std::optional<TFrame> TFrameSplitter::Pop() {
+    auto byteAt = [&](size_t i) { return static_cast<uint8_t>(View[(RPos + i) % Cap]); };
+    size_t prefixSize = 0;
+    uint64_t length = 0;
+    if (Prefix == EFramePrefix::Fixed32) {
+        if (Size < 4) {
+            return std::nullopt;
+        }
+        prefixSize = 4;
+        for (size_t i = 0; i < 4; ++i) {
+            length = (length << 8) | byteAt(i);
+        }
+    } else {
+        while (true) {
+            if (prefixSize == Size) {
+                return std::nullopt;
+            }
+            if (prefixSize == MaxPrefixSize) {
+                throw std::runtime_error("Malformed frame prefix");
+            }
+            auto byte = byteAt(prefixSize);
+            length |= static_cast<uint64_t>(byte & 0x7f) << (7 * prefixSize++);
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+    }
+    if (length > MaxFrameSize) {
+        throw std::runtime_error("Frame too large");
+    }
+    if (Size < prefixSize + length) {
+        return std::nullopt;
+    }
+
+    size_t start = (RPos + prefixSize) % Cap;
+    TFrame frame;
+    if (start + length <= Cap) {
+        frame.Part1 = View.substr(start, length);
+    } else {
+        frame.Part1 = View.substr(start);
+        frame.Part2 = View.substr(0, length - frame.Part1.size());
+    }
+    RPos = (start + length) % Cap;
+    Size -= prefixSize + length;
+    return frame;
+}
+
+size_t TFrameSplitter::PopAll(std::vector<TFrame>& frames) {
+    size_t count = 0;
+    while (auto frame = Pop()) {
+        frames.push_back(*frame);
+        ++count;
+    }
+    return count;
+}
+
+std::span<char> TFrameSplitter::Acquire(size_t size) {
+    if (Pool && !Buffer) {
+        Buffer = Pool->Acquire(Cap);
+        View = {Buffer.Data(), Cap};
+    }
+    size = std::min(size, Cap - Size);
+    if (size == 0) {
+        throw std::runtime_error("Overflow");
+    }
+    auto* data = const_cast<char*>(View.data());
+    auto first = std::min(size, Cap - WPos);
+    if (first) {
+        return {data + WPos, first};
+    } else {
+        return {data, size};
+    }
+}
+
+void TFrameSplitter::Commit(size_t size) {
+    WPos = (WPos + size) % Cap;
+    Size += size;
+}
+
+void TFrameSplitter::Push(const char* p, size_t len) {
+    while (len != 0) {
+        auto buf = Acquire(len);
+        memcpy(buf.data(), p, buf.size());
+        Commit(buf.size());
+        len -= buf.size();
+        p += buf.size();
+    }
+}
+
+void TFrameSplitter::ReleaseBuffer() {
+    if (Pool && Size == 0) {
+        Buffer.Release();
+        View = {};
+        WPos = RPos = 0;
+    }
+}
+
+size_t TFrameSplitter::EncodePrefix(EFramePrefix prefix, size_t size, char* out) {
+    if (prefix == EFramePrefix::Fixed32) {
+        for (int i = 3; i >= 0; --i) {
+            out[i] = static_cast<char>(size & 0xff);
+            size >>= 8;
+        }
+        return 4;
+    }
+    size_t len = 0;
+    do {
+        uint8_t byte = size & 0x7f;
+        size >>= 7;
+        out[len++] = static_cast<char>(size ? byte | 0x80 : byte);
+    } while (size);
+    return len;
+}
+
+}  // namespace NNet
@@ -0,0 +1,222 @@
+#pragma once
+#include <sys/uio.h>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bufferpool.h"
+#include "corochain.h"
+#include "sockutils.h"
+
+namespace NNet {
+
+/**
+ * @brief Length prefix of a frame: 4 bytes big-endian or an unsigned LEB128 varint.
+ */
+enum class EFramePrefix {
+    Fixed32,
+    Varint,
+};
+
+/**
+ * @brief Payload of a frame, split in two when it wraps around the end of the ring buffer.
+ */
+struct TFrame {
+    std::string_view Part1;
+    std::string_view Part2;
+
+    size_t Size() const { return Part1.size() + Part2.size(); }
+
+    /**
+     * @brief Copies the payload into @p out, for frames that outlive the next read.
+     */
+    void CopyTo(std::string& out) const {
+        out.assign(Part1);
+        out.append(Part2);
+    }
+};
+
+/**
+ * @brief Ring buffer of incoming bytes cut into length-prefixed frames without copying.
+ *
+ * Frames above @p maxFrameSize are rejected with an exception as soon as their prefix is
+ * read. The ring holds twice the max frame, the storage is borrowed from @p pool like in
+ * TZeroCopyLineSplitter.
+ */
+struct TFrameSplitter {
+ public:
+    TFrameSplitter(EFramePrefix prefix, size_t maxFrameSize, TBufferPool* pool = nullptr);
+
+    /**
+     * @brief Cuts the next complete frame, std::nullopt if it has not fully arrived yet.
+     */
+    std::optional<TFrame> Pop();
+
+    /**
+     * @brief Appends every complete frame to @p frames, returns their number.
+     */
+    size_t PopAll(std::vector<TFrame>& frames);
+
+    std::span<char> Acquire(size_t size);
+    void Commit(size_t size);
+    void Push(const char* p, size_t len);
+
+    bool Empty() const { return Size == 0; }
+
+    /**
+     * @brief Returns the storage to the pool if nothing is pending, invalidates popped frames.
+     */
+    void ReleaseBuffer();
+
+    /**
+     * @brief Encodes the prefix of a @p size byte frame into @p out, returns its length.
+     */
+    static size_t EncodePrefix(EFramePrefix prefix, size_t size, char* out);
+
+    static constexpr size_t MaxPrefixSize = 5;
+
+ private:
+    EFramePrefix Prefix;
+    size_t MaxFrameSize;
+    size_t WPos;
+    size_t RPos;
+    size_t Size;
+    size_t Cap;
+    TBufferPool* Pool;
+    TPooledBuffer Buffer;
+    std::string Data;
+    std::string_view View;
+};
+
+/**
+ * @brief Reads length-prefixed frames from a socket, a frame stays valid until the next read.
+ */
+template <typename TSocket>
+struct TFrameReader {
+    TFrameReader(TSocket& socket, EFramePrefix prefix, size_t maxFrameSize = 16384)
+        : TFrameReader(socket, prefix, maxFrameSize, &socket.Poller()->BufferPool()) {}
+
+    TFrameReader(TSocket& socket, EFramePrefix prefix, size_t maxFrameSize, TBufferPool* pool)
+        : Socket(socket), Splitter(prefix, maxFrameSize, pool),
+          ChunkSize(maxFrameSize) {}
+
+    /**
+     * @brief The next frame, std::nullopt at the end of the stream.
+     *
+     * Throws TTimeoutError if the frame is not complete by @p deadline.
+     */
+    TValueTask<std::optional<TFrame>> Read(TTime deadline = TTime::max()) {
+        auto frame = Splitter.Pop();
+        while (!frame) {
+            bool more = co_await Fill(deadline);
+            if (!more) {
+                break;
+            }
+            frame = Splitter.Pop();
+        }
+        co_return frame;
+    }
+
+    /**
+     * @brief Every complete frame available after one read, empty at the end of the stream.
+     */
+    TValueTask<std::span<const TFrame>> ReadFrames(TTime deadline = TTime::max()) {
+        Frames.clear();
+        while (!Splitter.PopAll(Frames)) {
+            bool more = co_await Fill(deadline);
+            if (!more) {
+                break;
+            }
+        }
+        co_return std::span<const TFrame>(Frames);
+    }
+
+ private:
+    // one read into the splitter, false at the end of the stream
+    TValueTask<bool> Fill(TTime deadline) {
+        while (true) {
+            // borrowing from the pool is cheap, the buffer goes back before a wait if empty
+            auto buf = Splitter.Acquire(ChunkSize);
+            auto size = Socket.TryReadSome(buf.data(), buf.size());
+            if (size < 0) {
+                Splitter.ReleaseBuffer();
+                co_await Socket.WaitReadableYield(deadline);
+                continue;
+            }
+            if (size == 0) {
+                co_return false;
+            }
+            Splitter.Commit(size);
+            co_return true;
+        }
+    }
+
+    TSocket& Socket;
+    TFrameSplitter Splitter;
+    size_t ChunkSize;
+    std::vector<TFrame> Frames;
+};
+
+/**
+ * @brief Queues length-prefixed frames and writes them all with one writev per wakeup.
+ *
+ * The payloads are not copied, they must stay alive until Flush() completes.
+ */
+template <typename TSocket>
+struct TFrameWriter {
+    TFrameWriter(TSocket& socket, EFramePrefix prefix, size_t maxFrameSize = 16384)
+        : Writer(socket), Prefix(prefix), MaxFrameSize(maxFrameSize) {}
+
+    void Add(const void* data, size_t size) {
+        if (size > MaxFrameSize) {
+            throw std::runtime_error("Frame too large");
+        }
+        size_t offset = Prefixes.size();
+        Prefixes.resize(offset + TFrameSplitter::MaxPrefixSize);
+        size_t prefixSize = TFrameSplitter::EncodePrefix(Prefix, size, &Prefixes[offset]);
+        Prefixes.resize(offset + prefixSize);
+        Pending.push_back({offset, prefixSize, data, size});
+    }
+
+    TValueTask<void> Flush(TTime deadline = TTime::max()) {
+        // frames added while this flush is in progress go to the next one
+        auto prefixes = std::move(Prefixes);
+        auto pending = std::move(Pending);
+        Prefixes.clear();
+        Pending.clear();
+        std::vector<iovec> iov;
+        iov.reserve(pending.size() * 2);
+        for (auto& frame : pending) {
+            iov.push_back({&prefixes[frame.PrefixOffset], frame.PrefixSize});
+            iov.push_back({const_cast<void*>(frame.Data), frame.Size});
+        }
+        co_await Writer.Write(iov, deadline);
+        co_return;
+    }
+
+    TValueTask<void> Write(const void* data, size_t size, TTime deadline = TTime::max()) {
+        Add(data, size);
+        co_await Flush(deadline);
+        co_return;
+    }
+
+ private:
+    struct TPendingFrame {
+        size_t PrefixOffset;
+        size_t PrefixSize;
+        const void* Data;
+        size_t Size;
+    };
+
+    TByteWriter<TSocket> Writer;
+    EFramePrefix Prefix;
+    size_t MaxFrameSize;
+    std::vector<char> Prefixes;
+    std::vector<TPendingFrame> Pending;
+};
+
+}  // namespace NNet
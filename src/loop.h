@@ -1,5 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <utility>
+
+#include "base.h"
+
 namespace NNet {
 
 template <typename TPoller>
@@ -11,17 +17,44 @@ class TLoop {
         }
     }
 
-    void Stop() { running_ = false; }
+    /**
+     * @brief Makes Loop() return after the current step, may be called from any thread.
+     */
+    void Stop() {
+        running_ = false;
+        poller_.Wake();
+    }
+
+    /**
+     * @brief Runs @p func on the loop thread, may be called from any thread.
+     */
+    template <typename TFunc>
+    void Post(TFunc&& func) {
+        poller_.Post(std::forward<TFunc>(func));
+    }
+
+    /**
+     * @brief Busy-polling mode for latency-critical loops, see TPollerBase::SetBusyPoll().
+     *
+     * Example: loop.SetBusyPoll(std::chrono::microseconds(50));
+     */
+    void SetBusyPoll(std::chrono::nanoseconds budget, bool adaptive = true) {
+        poller_.SetBusyPoll(budget, adaptive);
+    }
 
     void Step() {
+        auto start = TClock::now();
+        poller_.BeginStep(start);
         poller_.Poll();
         poller_.WakeupReadyHandles();
+        poller_.FlushDeferred();
+        poller_.EndStep(start, TClock::now());
     }
 
     TPoller& Poller() { return poller_; }
 
  private:
     TPoller poller_;
-    bool running_ = true;
+    std::atomic<bool> running_ = true;
 };
 }  // namespace NNet
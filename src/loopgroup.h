@@ -0,0 +1,209 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "address.h"
+#include "loop.h"
+#include "metrics.h"
+
+namespace NNet {
+
+enum class EListenMode {
+    ReusePort,  // a listener per loop bound with SO_REUSEPORT, the kernel balances connections
+    Exclusive,  // one listener shared by all loops, registered with EPOLLEXCLUSIVE
+};
+
+/**
+ * @class TLoopGroup
+ * @brief Runs N independent TLoop instances, one per (optionally pinned) thread.
+ *
+ * Loops share nothing: a connection accepted by a loop is served by the same loop
+ * for its whole life. Pollers may be accessed from other threads only before Start().
+ *
+ * Example:
+ * @code
+ * TLoopGroup<TEpoll> group(4);
+ * auto listeners = group.Listen(TAddress{"0.0.0.0", 8888});
+ * group.Start([&](size_t i, TLoop<TEpoll>& loop) { server(std::move(listeners[i]), &loop); });
+ * group.Join();
+ * @endcode
+ */
+template <typename TPoller>
+class TLoopGroup {
+ public:
+    using TSocket = typename TPoller::TSocket;
+    using TInit = std::function<void(size_t index, TLoop<TPoller>& loop)>;
+
+    explicit TLoopGroup(size_t size = std::thread::hardware_concurrency(), bool pin = true)
+        : pin_(pin) {
+        if (size == 0) {
+            size = 1;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            loops_.emplace_back(std::make_unique<TLoop<TPoller>>());
+        }
+        errors_.resize(size);
+    }
+
+    TLoopGroup(const TLoopGroup&) = delete;
+    TLoopGroup& operator=(const TLoopGroup&) = delete;
+
+    ~TLoopGroup() {
+        Stop();
+        for (auto& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+    size_t Size() const { return loops_.size(); }
+
+    TLoop<TPoller>& Loop(size_t index) { return *loops_.at(index); }
+
+    TPoller& Poller(size_t index) { return loops_.at(index)->Poller(); }
+
+    /**
+     * @brief Metrics of every loop, may be called from any thread, also after Start().
+     *
+     * Example: WritePrometheus(out, group.MetricsSnapshot());
+     */
+    std::vector<TLoopMetricsSnapshot> MetricsSnapshot() {
+        std::vector<TLoopMetricsSnapshot> snapshots;
+        for (auto& loop : loops_) {
+            snapshots.push_back(loop->Poller().Metrics().Snapshot());
+        }
+        return snapshots;
+    }
+
+    /**
+     * @brief Creates a listening socket for every loop, the i-th one belongs to Poller(i).
+     *
+     * Must be called before Start().
+     */
+    std::vector<TSocket> Listen(const TAddress& addr, EListenMode mode = EListenMode::ReusePort,
+                                int backlog = 128) {
+        std::vector<TSocket> listeners;
+        listeners.reserve(Size());
+        if (mode == EListenMode::ReusePort) {
+            for (size_t i = 0; i < Size(); ++i) {
+                TSocket socket(Poller(i), addr.Domain());
+                socket.SetReusePort();
+                socket.Bind(addr);
+                socket.Listen(backlog);
+                listeners.emplace_back(std::move(socket));
+            }
+            return listeners;
+        }
+
+        if constexpr (requires(TPoller& poller) { poller.SetExclusive(0); }) {
+            TSocket first(Poller(0), addr.Domain());
+            first.Bind(addr);
+            first.Listen(backlog);
+            int fd = first.Fd();
+            Poller(0).SetExclusive(fd);
+            listeners.emplace_back(std::move(first));
+            for (size_t i = 1; i < Size(); ++i) {
+                int copy = dup(fd);
+                if (copy < 0) {
+                    throw std::system_error(errno, std::generic_category(), "dup");
+                }
+                Poller(i).SetExclusive(copy);
+                listeners.emplace_back(TSocket(copy, Poller(i)));
+            }
+            return listeners;
+        } else {
+            throw std::logic_error("Exclusive listen mode is not supported by this poller");
+        }
+    }
+
+    /**
+     * @brief Starts a thread per loop, @p init is called in the loop thread before Loop().
+     */
+    void Start(TInit init = {}) {
+        if (!threads_.empty()) {
+            throw std::logic_error("Loop group is already started");
+        }
+        auto cpus = AllowedCpus();
+        for (size_t i = 0; i < Size(); ++i) {
+            threads_.emplace_back([this, i, init] {
+                try {
+                    if (init) {
+                        init(i, *loops_[i]);
+                    }
+                    loops_[i]->Loop();
+                } catch (...) {
+                    errors_[i] = std::current_exception();
+                    Stop();
+                }
+            });
+            auto name = "tinynet-" + std::to_string(i);
+            pthread_setname_np(threads_.back().native_handle(), name.substr(0, 15).c_str());
+            if (pin_ && !cpus.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpus[i % cpus.size()], &set);
+                pthread_setaffinity_np(threads_.back().native_handle(), sizeof(set), &set);
+            }
+        }
+    }
+
+    /**
+     * @brief Asks every loop to stop, they leave Loop() after the current step.
+     */
+    void Stop() {
+        for (auto& loop : loops_) {
+            loop->Stop();
+        }
+    }
+
+    /**
+     * @brief Waits for all loop threads, rethrows the first exception thrown by a loop.
+     */
+    void Join() {
+        for (auto& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        for (auto& error : errors_) {
+            if (error) {
+                std::rethrow_exception(std::exchange(error, nullptr));
+            }
+        }
+    }
+
+ private:
+    static std::vector<int> AllowedCpus() {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        return cpus;
+    }
+
+    bool pin_;
+    std::vector<std::unique_ptr<TLoop<TPoller>>> loops_;
+    std::vector<std::thread> threads_;
+    std::vector<std::exception_ptr> errors_;
+};
+
+}  // namespace NNet
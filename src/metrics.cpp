@@ -0,0 +1,159 @@
+#include "metrics.h"
+
+#include <cstdio>
+#include <string>
+
+namespace NNet {
+
+TLoopMetricsSnapshot& TLoopMetricsSnapshot::operator+=(const TLoopMetricsSnapshot& other) {
+    EpollCtlAdd += other.EpollCtlAdd;
+    EpollCtlMod += other.EpollCtlMod;
+    EpollCtlDel += other.EpollCtlDel;
+    UringSubmitted += other.UringSubmitted;
+    Wakeups += other.Wakeups;
+    TimersFired += other.TimersFired;
+    TimersCancelled += other.TimersCancelled;
+    ReadCalls += other.ReadCalls;
+    WriteCalls += other.WriteCalls;
+    BytesRead += other.BytesRead;
+    BytesWritten += other.BytesWritten;
+    Again += other.Again;
+    SpinNs += other.SpinNs;
+    SpinPolls += other.SpinPolls;
+    SpinHits += other.SpinHits;
+    SpinMisses += other.SpinMisses;
+    StepNs += other.StepNs;
+    WaitNs += other.WaitNs;
+    EventsPerPoll += other.EventsPerPoll;
+    ChangesPerPoll += other.ChangesPerPoll;
+    ReadyPerPoll += other.ReadyPerPoll;
+    return *this;
+}
+
+TLoopMetricsSnapshot TLoopMetrics::Snapshot() const {
+    TLoopMetricsSnapshot snapshot;
+    snapshot.EpollCtlAdd = EpollCtlAdd.Get();
+    snapshot.EpollCtlMod = EpollCtlMod.Get();
+    snapshot.EpollCtlDel = EpollCtlDel.Get();
+    snapshot.UringSubmitted = UringSubmitted.Get();
+    snapshot.Wakeups = Wakeups.Get();
+    snapshot.TimersFired = TimersFired.Get();
+    snapshot.TimersCancelled = TimersCancelled.Get();
+    snapshot.ReadCalls = ReadCalls.Get();
+    snapshot.WriteCalls = WriteCalls.Get();
+    snapshot.BytesRead = BytesRead.Get();
+    snapshot.BytesWritten = BytesWritten.Get();
+    snapshot.Again = Again.Get();
+    snapshot.SpinNs = SpinNs.Get();
+    snapshot.SpinPolls = SpinPolls.Get();
+    snapshot.SpinHits = SpinHits.Get();
+    snapshot.SpinMisses = SpinMisses.Get();
+    snapshot.StepNs = StepNs.Snapshot();
+    snapshot.WaitNs = WaitNs.Snapshot();
+    snapshot.EventsPerPoll = EventsPerPoll.Snapshot();
+    snapshot.ChangesPerPoll = ChangesPerPoll.Snapshot();
+    snapshot.ReadyPerPoll = ReadyPerPoll.Snapshot();
+    return snapshot;
+}
+
+namespace {
+
+std::string Labels(size_t loop, const char* extra = nullptr) {
+    std::string labels = "{loop=\"" + std::to_string(loop) + "\"";
+    if (extra) {
+        labels += ",";
+        labels += extra;
+    }
+    return labels + "}";
+}
+
+void Header(std::ostream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+template <typename TField>
+void Counter(std::ostream& out, std::span<const TLoopMetricsSnapshot> loops, const char* name,
+             const char* help, TField field) {
+    Header(out, name, "counter", help);
+    for (size_t i = 0; i < loops.size(); ++i) {
+        out << name << Labels(i) << " " << loops[i].*field << "\n";
+    }
+}
+
+// the bounds are 2^i * scale: nanoseconds are exported as seconds
+template <size_t N>
+void Histogram(std::ostream& out, std::span<const TLoopMetricsSnapshot> loops, const char* name,
+               const char* help, THistogramSnapshot<N> TLoopMetricsSnapshot::*field,
+               double scale) {
+    Header(out, name, "histogram", help);
+    for (size_t i = 0; i < loops.size(); ++i) {
+        const auto& h = loops[i].*field;
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b + 1 < N; ++b) {
+            cumulative += h.Counts[b];
+            char le[32];
+            snprintf(le, sizeof(le), "le=\"%g\"", static_cast<double>(uint64_t(1) << b) * scale);
+            out << name << "_bucket" << Labels(i, le) << " " << cumulative << "\n";
+        }
+        cumulative += h.Counts[N - 1];
+        out << name << "_bucket" << Labels(i, "le=\"+Inf\"") << " " << cumulative << "\n";
+        out << name << "_sum" << Labels(i) << " " << static_cast<double>(h.Sum) * scale << "\n";
+        out << name << "_count" << Labels(i) << " " << cumulative << "\n";
+    }
+}
+
+}  // namespace
+
+void WritePrometheus(std::ostream& out, std::span<const TLoopMetricsSnapshot> loops) {
+    using S = TLoopMetricsSnapshot;
+    Header(out, "tinynet_epoll_ctl_total", "counter", "epoll_ctl calls by operation.");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        out << "tinynet_epoll_ctl_total" << Labels(i, "op=\"add\"") << " " << loops[i].EpollCtlAdd
+            << "\n";
+        out << "tinynet_epoll_ctl_total" << Labels(i, "op=\"mod\"") << " " << loops[i].EpollCtlMod
+            << "\n";
+        out << "tinynet_epoll_ctl_total" << Labels(i, "op=\"del\"") << " " << loops[i].EpollCtlDel
+            << "\n";
+    }
+    Counter(out, loops, "tinynet_uring_submitted_total", "SQEs submitted to io_uring.",
+            &S::UringSubmitted);
+    Counter(out, loops, "tinynet_wakeups_total", "Coroutines resumed by the poller.",
+            &S::Wakeups);
+    Counter(out, loops, "tinynet_timers_fired_total", "Timers fired.", &S::TimersFired);
+    Counter(out, loops, "tinynet_timers_cancelled_total", "Timers removed before firing.",
+            &S::TimersCancelled);
+    Counter(out, loops, "tinynet_read_calls_total", "Socket reads.", &S::ReadCalls);
+    Counter(out, loops, "tinynet_write_calls_total", "Socket writes.", &S::WriteCalls);
+    Counter(out, loops, "tinynet_read_bytes_total", "Bytes read from sockets.", &S::BytesRead);
+    Counter(out, loops, "tinynet_written_bytes_total", "Bytes written to sockets.",
+            &S::BytesWritten);
+    Counter(out, loops, "tinynet_eagain_total", "Socket operations that had to wait.",
+            &S::Again);
+    Header(out, "tinynet_spin_seconds_total", "counter",
+           "Time spent busy polling before blocking.");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        out << "tinynet_spin_seconds_total" << Labels(i) << " "
+            << static_cast<double>(loops[i].SpinNs) * 1e-9 << "\n";
+    }
+    Counter(out, loops, "tinynet_spin_polls_total", "Zero-timeout waits of busy polling.",
+            &S::SpinPolls);
+    Header(out, "tinynet_spins_total", "counter", "Busy polling spins by outcome.");
+    for (size_t i = 0; i < loops.size(); ++i) {
+        out << "tinynet_spins_total" << Labels(i, "result=\"hit\"") << " " << loops[i].SpinHits
+            << "\n";
+        out << "tinynet_spins_total" << Labels(i, "result=\"miss\"") << " "
+            << loops[i].SpinMisses << "\n";
+    }
+    Histogram(out, loops, "tinynet_step_duration_seconds",
+              "Loop iteration time without the time blocked in the poller.", &S::StepNs, 1e-9);
+    Histogram(out, loops, "tinynet_wait_duration_seconds", "Time blocked in the poller.",
+              &S::WaitNs, 1e-9);
+    Histogram(out, loops, "tinynet_poll_events", "Events reported by one poller wait.",
+              &S::EventsPerPoll, 1);
+    Histogram(out, loops, "tinynet_poll_changes", "Registrations applied by one Poll().",
+              &S::ChangesPerPoll, 1);
+    Histogram(out, loops, "tinynet_poll_ready", "Coroutines made ready by one Poll().",
+              &S::ReadyPerPoll, 1);
+}
+
+}  // namespace NNet
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <sys/types.h>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <span>
+
+namespace NNet {
+
+/**
+ * @brief Counter written by the loop thread only, readable from any thread.
+ *
+ * Add() is a relaxed load and store: a plain add, no locked instruction.
+ */
+class TMetricCounter {
+ public:
+    void Add(uint64_t n = 1) {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    uint64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+    std::atomic<uint64_t> value_ = 0;
+};
+
+template <size_t N>
+struct THistogramSnapshot {
+    static constexpr size_t Buckets = N;
+
+    std::array<uint64_t, N> Counts = {};  // bucket i: values in (2^(i-1), 2^i], the last is +Inf
+    uint64_t Sum = 0;
+
+    uint64_t Count() const {
+        uint64_t count = 0;
+        for (auto c : Counts) {
+            count += c;
+        }
+        return count;
+    }
+
+    THistogramSnapshot& operator+=(const THistogramSnapshot& other) {
+        for (size_t i = 0; i < N; ++i) {
+            Counts[i] += other.Counts[i];
+        }
+        Sum += other.Sum;
+        return *this;
+    }
+};
+
+/**
+ * @brief Histogram with power of two buckets, same threading as TMetricCounter.
+ */
+template <size_t N>
+class TMetricHistogram {
+ public:
+    void Record(uint64_t value) {
+        size_t index = value <= 1 ? 0 : std::bit_width(value - 1);
+        counts_[index < N ? index : N - 1].Add();
+        sum_.Add(value);
+    }
+
+    THistogramSnapshot<N> Snapshot() const {
+        THistogramSnapshot<N> snapshot;
+        for (size_t i = 0; i < N; ++i) {
+            snapshot.Counts[i] = counts_[i].Get();
+        }
+        snapshot.Sum = sum_.Get();
+        return snapshot;
+    }
+
+ private:
+    std::array<TMetricCounter, N> counts_;
+    TMetricCounter sum_;
+};
+
+using TDurationHistogram = THistogramSnapshot<32>;  // ns, up to 2^30 (1s)
+using TSizeHistogram = THistogramSnapshot<16>;      // up to 2^14
+
+/**
+ * @brief Copy of the metrics of a loop, see TLoopMetrics.
+ */
+struct TLoopMetricsSnapshot {
+    uint64_t EpollCtlAdd = 0;     // epoll_ctl calls by operation
+    uint64_t EpollCtlMod = 0;
+    uint64_t EpollCtlDel = 0;
+    uint64_t UringSubmitted = 0;  // SQEs taken by io_uring_enter
+    uint64_t Wakeups = 0;         // coroutines resumed for I/O readiness or cross-thread
+    uint64_t TimersFired = 0;
+    uint64_t TimersCancelled = 0;
+    uint64_t ReadCalls = 0;       // read syscalls (completions for io_uring)
+    uint64_t WriteCalls = 0;
+    uint64_t BytesRead = 0;
+    uint64_t BytesWritten = 0;
+    uint64_t Again = 0;           // socket operations that got EAGAIN and had to wait
+    uint64_t SpinNs = 0;          // busy polling: time spent spinning before blocking
+    uint64_t SpinPolls = 0;       // zero-timeout waits
+    uint64_t SpinHits = 0;        // spins that found events
+    uint64_t SpinMisses = 0;      // spins that found nothing
+
+    TDurationHistogram StepNs;    // Step() without the time blocked in the poller
+    TDurationHistogram WaitNs;    // time in epoll_pwait / io_uring_enter, spinning included
+    TSizeHistogram EventsPerPoll;   // descriptors or completions reported by one wait
+    TSizeHistogram ChangesPerPoll;  // registrations applied before the wait
+    TSizeHistogram ReadyPerPoll;    // coroutines queued for WakeupReadyHandles()
+
+    TLoopMetricsSnapshot& operator+=(const TLoopMetricsSnapshot& other);
+};
+
+/**
+ * @brief Counters and histograms of one loop, always on.
+ *
+ * Owned by the poller and updated by the loop thread without synchronization,
+ * Snapshot() may be called from any thread (a snapshot is not atomic as a whole).
+ */
+struct TLoopMetrics {
+    TMetricCounter EpollCtlAdd;
+    TMetricCounter EpollCtlMod;
+    TMetricCounter EpollCtlDel;
+    TMetricCounter UringSubmitted;
+    TMetricCounter Wakeups;
+    TMetricCounter TimersFired;
+    TMetricCounter TimersCancelled;
+    TMetricCounter ReadCalls;
+    TMetricCounter WriteCalls;
+    TMetricCounter BytesRead;
+    TMetricCounter BytesWritten;
+    TMetricCounter Again;
+    TMetricCounter SpinNs;
+    TMetricCounter SpinPolls;
+    TMetricCounter SpinHits;
+    TMetricCounter SpinMisses;
+
+    TMetricHistogram<TDurationHistogram::Buckets> StepNs;
+    TMetricHistogram<TDurationHistogram::Buckets> WaitNs;
+    TMetricHistogram<TSizeHistogram::Buckets> EventsPerPoll;
+    TMetricHistogram<TSizeHistogram::Buckets> ChangesPerPoll;
+    TMetricHistogram<TSizeHistogram::Buckets> ReadyPerPoll;
+
+    std::chrono::nanoseconds LastWait{0};  // loop thread only, subtracted from the step
+
+    void CountRead(ssize_t ret) {
+        ReadCalls.Add();
+        if (ret > 0) {
+            BytesRead.Add(ret);
+        }
+    }
+
+    void CountWrite(ssize_t ret) {
+        WriteCalls.Add();
+        if (ret > 0) {
+            BytesWritten.Add(ret);
+        }
+    }
+
+    void RecordWait(std::chrono::nanoseconds wait) {
+        LastWait = wait;
+        WaitNs.Record(wait.count());
+    }
+
+    void RecordStep(std::chrono::nanoseconds step) {
+        auto busy = step - LastWait;
+        StepNs.Record(busy.count() > 0 ? busy.count() : 0);
+        LastWait = {};
+    }
+
+    TLoopMetricsSnapshot Snapshot() const;
+};
+
+/**
+ * @brief Writes the snapshots in the Prometheus text format, the i-th one labelled loop="i".
+ */
+void WritePrometheus(std::ostream& out, std::span<const TLoopMetricsSnapshot> loops);
+
+}  // namespace NNet
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+
+namespace NNet {
+
+/**
+ * @class TMpscQueue
+ * @brief Intrusive lock-free multi-producer single-consumer FIFO (Vyukov).
+ *
+ * TNode must have a `std::atomic<TNode*> Next` member. Push() is wait-free and may
+ * be called from any thread, Pop() only from the consumer thread. Pop() may return
+ * nullptr while a producer is between its two steps, the node shows up once the
+ * producer is done, so the consumer must be notified after Push() returns.
+ */
+template <typename TNode>
+class TMpscQueue {
+ public:
+    TMpscQueue() = default;
+    TMpscQueue(const TMpscQueue&) = delete;
+    TMpscQueue& operator=(const TMpscQueue&) = delete;
+
+    void Push(TNode* node) {
+        node->Next.store(nullptr, std::memory_order_relaxed);
+        TNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->Next.store(node, std::memory_order_release);
+    }
+
+    TNode* Pop() {
+        TNode* tail = tail_;
+        TNode* next = tail->Next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next) {
+                return nullptr;
+            }
+            tail_ = tail = next;
+            next = next->Next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return nullptr;  // a producer has not linked its node yet
+        }
+        Push(&stub_);
+        next = tail->Next.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+ private:
+    TNode stub_;
+    std::atomic<TNode*> head_ = &stub_;
+    alignas(64) TNode* tail_ = &stub_;  // consumer side, kept off the producers' cache line
+};
+
+}  // namespace NNet
@@ -1,41 +1,101 @@
 #pragma once
 
 #include <assert.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
 #include <chrono>
 #include <coroutine>
-#include <iostream>
 #include <map>
-#include <queue>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "base.h"
+#include "bufferpool.h"
+#include "metrics.h"
+#include "mpsc.h"
+#include "timerwheel.h"
+#include "trace.h"
+#include "watchdog.h"
 
 namespace NNet {
+
+/**
+ * @brief Node of the cross-thread queue of a poller, usually embedded in an awaitable.
+ */
+struct TRemoteNode {
+    std::atomic<TRemoteNode*> Next = nullptr;
+    THandle Handle;  // resumed on the loop thread if Run is not set
+    void (*Run)(TRemoteNode* node, bool cancel) = nullptr;  // called instead, owns the node
+};
+
+/**
+ * @brief Node of the writers flushed at the end of a loop step, usually embedded in a writer.
+ */
+struct TDeferredFlush {
+    void (*Flush)(TDeferredFlush* node) = nullptr;  // must not throw
+    bool Queued = false;
+};
+
 class TPollerBase {
  public:
-    TPollerBase() = default;
+    TPollerBase() : wake_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (wake_fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+        }
+    }
+
+    ~TPollerBase() {
+        // a producer may still be waking us after its node was consumed
+        while (remote_producers_.load(std::memory_order_acquire)) {
+            sched_yield();
+        }
+        while (auto* node = remote_.Pop()) {
+            if (node->Run) {
+                node->Run(node, true);
+            }
+        }
+        close(wake_fd_);
+    }
+
     TPollerBase(const TPollerBase &) = delete;
     TPollerBase &operator=(const TPollerBase &) = delete;
 
-    unsigned AddTimer(TTime deadline, THandle handle) {
-        timers_.emplace(TTimer{deadline, time_id_, handle});
-        std::cout << "timer id: " << time_id_ << std::endl;
-        return time_id_++;
+    TTimerId AddTimer(TTime deadline, THandle handle) {
+        auto id = timers_.Add(deadline, handle);
+        TN_TRACE(trace_, Debug, TimerAdd, id, deadline.time_since_epoch().count());
+        return id;
     }
 
-    unsigned RemoveTimer(unsigned timer_id, TTime deadline) {
-        bool fired = timer_id == last_fired_timer_;
-        if (!fired) {
-            timers_.emplace(TTimer{deadline, timer_id, THandle{}});
+    /**
+     * @brief Cancels a pending timer in O(1).
+     *
+     * @return true if the timer has already fired (or was removed before).
+     */
+    bool RemoveTimer(TTimerId timer_id) {
+        if (timers_.Remove(timer_id)) {
+            metrics_.TimersCancelled.Add();
+            return false;
         }
-        return fired;
+        return true;
     }
 
+    /**
+     * @brief Sets the timer wheel resolution, only while there are no pending timers.
+     *
+     * Timers never fire early, the tick only bounds how far one step advances.
+     */
+    void SetTimerTick(std::chrono::nanoseconds tick) { timers_.SetTick(tick); }
+
     void AddRead(int fd, THandle handle) {
         max_fd_ = std::max(max_fd_, fd);
-        std::cout << "current max fd: " << max_fd_ << ", input fd: " << fd << std::endl;
         changes_.emplace_back(std::move(TEvent{fd, TEvent::READ, handle}));
-        std::cout << "current changes size: " << changes_.size() << std::endl;
+        TN_TRACE(trace_, Debug, AddRead, fd, max_fd_, changes_.size());
     }
 
     void AddWrite(int fd, THandle handle) {
@@ -48,20 +108,48 @@ class TPollerBase {
         changes_.emplace_back(std::move(TEvent{fd, TEvent::RHUP, handle}));
     }
 
+    /**
+     * @brief Waits for a pending socket error or error queue message (EPOLLERR/POLLERR).
+     */
+    void AddError(int fd, THandle handle) {
+        max_fd_ = std::max(max_fd_, fd);
+        changes_.emplace_back(std::move(TEvent{fd, TEvent::ERR, handle}));
+    }
+
     void RemoveEvent(int fd) {
         max_fd_ = std::max(max_fd_, fd);
-        changes_.emplace_back(
-            std::move(TEvent{fd, TEvent::READ | TEvent::WRITE | TEvent::RHUP, THandle{}}));
+        changes_.emplace_back(std::move(
+            TEvent{fd, TEvent::READ | TEvent::WRITE | TEvent::RHUP | TEvent::ERR, THandle{}}));
+    }
+
+    /**
+     * @brief Drops the wakeups of @p h queued by the last Poll() and not delivered yet.
+     */
+    void RemoveEvent(THandle h) {
+        for (auto &ev : ready_events_) {
+            if (ev.Handle == h) {
+                ev.Handle = {};
+            }
+        }
     }
 
-    void RemoveEvent(THandle /*h */) {}
+    /**
+     * @brief Forgets a coroutine that gave up waiting for @p type events on @p fd.
+     *
+     * Called when its deadline fires: the fd may have become ready in the same Poll(),
+     * so the queued wakeup is dropped too, the coroutine must not be resumed twice.
+     */
+    void RemoveWait(int fd, int type, THandle h) {
+        changes_.emplace_back(std::move(TEvent{fd, type, THandle{}}));
+        RemoveEvent(h);
+    }
 
     auto Sleep(TTime until) {
         struct TAwaitableSleep {
             TAwaitableSleep(TPollerBase *poller, TTime n) : poller_(poller), n_(n) {}
             ~TAwaitableSleep() {
-                if (poller_) {
-                    poller_->RemoveEvent(timer_id_);
+                if (poller_ && timer_id_) {
+                    poller_->RemoveTimer(timer_id_);
                 }
             }
 
@@ -75,15 +163,16 @@ class TPollerBase {
             bool await_ready() { return false; }
 
             void await_suspend(std::coroutine_handle<> handle) {
-                std::cout << "Sleep..." << std::endl;
                 timer_id_ = poller_->AddTimer(n_, handle);
+                TN_TRACE(poller_->Trace(), Debug, SleepSuspend, timer_id_,
+                         n_.time_since_epoch().count());
             }
 
             void await_resume() { poller_ = nullptr; }
 
             TPollerBase *poller_;
             TTime n_;
-            unsigned timer_id_ = 0;
+            TTimerId timer_id_ = 0;
         };
 
         return TAwaitableSleep(this, until);
@@ -98,8 +187,8 @@ class TPollerBase {
 
     void Wakeup(TEvent &&change) {
         auto index = changes_.size();
-        change.Handle.resume();
-        if (change.Fd >= 0) {
+        Resume(change.Handle, EStallSource::Event, change.Fd, change.Type, 0);
+        if (change.Fd >= 0 && disarm_on_wakeup_) {
             bool matched = false;
             for (; index < changes_.size(); ++index) {
                 if (changes_[index].Match(change)) {
@@ -113,19 +202,153 @@ class TPollerBase {
         }
     }
 
+    /**
+     * @brief Queues @p node for the thread running this poller, may be called from any thread.
+     *
+     * Lock-free: the node is pushed to an MPSC queue and the eventfd is written only if
+     * the loop has not been woken since its last drain. The node must stay alive until
+     * the loop takes it.
+     */
+    void PushRemote(TRemoteNode* node) {
+        remote_producers_.fetch_add(1, std::memory_order_acq_rel);
+        remote_.Push(node);
+        if (!wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+            Wake();
+        }
+        remote_producers_.fetch_sub(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Runs @p func on the thread running this poller, may be called from any thread.
+     *
+     * Posted callables run in Poll() in FIFO order, an exception escapes from Poll().
+     * Callables still queued when the poller is destroyed are dropped without running.
+     */
+    template <typename TFunc>
+    void Post(TFunc&& func) {
+        struct TPosted : TRemoteNode {
+            explicit TPosted(TFunc&& f) : Func(std::forward<TFunc>(f)) {
+                Run = [](TRemoteNode* node, bool cancel) {
+                    std::unique_ptr<TPosted> self(static_cast<TPosted*>(node));
+                    if (!cancel) {
+                        self->Func();
+                    }
+                };
+            }
+            std::decay_t<TFunc> Func;
+        };
+        PushRemote(new TPosted(std::forward<TFunc>(func)));
+    }
+
+    /**
+     * @brief Interrupts a blocked Poll(), may be called from any thread.
+     */
+    void Wake() {
+        uint64_t one = 1;
+        [[maybe_unused]] auto ret = write(wake_fd_, &one, sizeof(one));
+    }
+
+    int WakeFd() const { return wake_fd_; }
+
+    /**
+     * @brief Queues @p node to be flushed by FlushDeferred(), once per step.
+     */
+    void DeferFlush(TDeferredFlush* node) {
+        if (!node->Queued) {
+            node->Queued = true;
+            deferred_flushes_.push_back(node);
+        }
+    }
+
+    void CancelFlush(TDeferredFlush* node) {
+        if (node->Queued) {
+            node->Queued = false;
+            std::erase(deferred_flushes_, node);
+        }
+    }
+
+    /**
+     * @brief Flushes the queued writers, called by TLoop at the end of every step.
+     */
+    void FlushDeferred() {
+        if (deferred_flushes_.empty()) {
+            return;
+        }
+        flushing_.swap(deferred_flushes_);
+        for (auto* node : flushing_) {
+            if (node->Queued) {  // not cancelled by an earlier flush
+                node->Queued = false;
+                node->Flush(node);
+            }
+        }
+        flushing_.clear();
+    }
+
     void WakeupReadyHandles() {
         for (auto &&ev : ready_events_) {
-            Wakeup(std::move(ev));
+            if (ev.Handle) {  // not dropped by RemoveEvent()
+                metrics_.Wakeups.Add();
+                Wakeup(std::move(ev));
+            }
+        }
+    }
+
+    auto TimersSize() const { return timers_.Size(); }
+
+    TTraceRing& Trace() { return trace_; }
+
+    /**
+     * @brief Counters of this loop, Metrics().Snapshot() may be taken from any thread.
+     */
+    TLoopMetrics& Metrics() { return metrics_; }
+
+    /**
+     * @brief Set by TLoopWatchdog::Watch(), the resumes and steps are timed while set.
+     */
+    void SetStallProbe(std::shared_ptr<TStallProbe> probe) { stall_probe_ = std::move(probe); }
+
+    /**
+     * @brief Called by TLoop around a step, feeds the metrics and the watchdog.
+     */
+    void BeginStep(TTime now) {
+        if (stall_probe_) {
+            stall_probe_->Busy(now);
         }
     }
 
-    auto TimersSize() const { return timers_.size(); }
+    void EndStep(TTime start, TTime now) {
+        metrics_.RecordStep(now - start);
+        if (stall_probe_) {
+            stall_probe_->Idle(now);
+        }
+    }
+
+    /**
+     * @brief I/O buffers shared by the readers of this loop, created on first use.
+     */
+    TBufferPool& BufferPool() {
+        if (!buffer_pool_) {
+            buffer_pool_ = std::make_unique<TBufferPool>();
+        }
+        return *buffer_pool_;
+    }
+
+    /**
+     * @brief Sets the options of the buffer pool, see TBufferPool::SetOptions().
+     *
+     * The pool is reconfigured in place: readers keep a pointer to it.
+     */
+    void SetBufferPoolOptions(TBufferPool::TOptions options) {
+        if (buffer_pool_) {
+            buffer_pool_->SetOptions(options);
+        } else {
+            buffer_pool_ = std::make_unique<TBufferPool>(options);
+        }
+    }
 
     timespec GetTimeout() const {
-        return timers_.empty() ? max_duration_ts_
-               : timers_.top().Deadline == TTime{}
-                   ? timespec{0, 0}
-                   : GetTimespec(TClock::now(), timers_.top().Deadline, max_duration_);
+        return timers_.Empty() ? max_duration_ts_
+                               : GetTimespec(TClock::now(), timers_.NextDeadline(), max_duration_);
     }
 
     static constexpr timespec GetMaxDuration(std::chrono::milliseconds duration) {
@@ -142,40 +365,211 @@ class TPollerBase {
         max_duration_ts_ = GetMaxDuration(max_duration_);
     }
 
+    /**
+     * @brief Busy polling: Poll() spins with zero-timeout waits for up to @p budget
+     * before it blocks, 0 turns it off.
+     *
+     * Trades a core for the sleep and wakeup latency of the blocking wait. Spinning stops
+     * at the next timer deadline, so timers fire as without it. With @p adaptive the spin
+     * budget follows the load, as KVM halt polling does: it doubles (up to @p budget)
+     * while the events come within @p budget after the spin started, a longer spin would
+     * have caught them, and halves down to zero while they come later. The time spent
+     * spinning is counted in the SpinNs metric, the useful work in StepNs.
+     */
+    void SetBusyPoll(std::chrono::nanoseconds budget, bool adaptive = true) {
+        busy_poll_max_ = std::max(budget, std::chrono::nanoseconds(0));
+        busy_poll_budget_ = busy_poll_max_;
+        busy_poll_adaptive_ = adaptive;
+    }
+
+    /**
+     * @brief Current spin budget, below the configured one while the adaptive mode shrinks it.
+     */
+    std::chrono::nanoseconds BusyPollBudget() const { return busy_poll_budget_; }
+
     void Reset() {
         ready_events_.clear();
         changes_.clear();
         max_fd_ = 0;
     }
 
+    /**
+     * @brief Takes the nodes queued by other threads, called by Poll() after waiting.
+     *
+     * Handles are moved to the ready events, posted callables are run.
+     */
+    void ProcessRemote() {
+        // cleared first: a node pushed after this point wakes the next Poll()
+        wake_pending_.exchange(false, std::memory_order_acq_rel);
+        while (auto* node = remote_.Pop()) {
+            if (node->Run) {
+                try {
+                    if (stall_probe_) {
+                        auto probe = stall_probe_;
+                        probe->BeginResume(EStallSource::Posted, -1, 0, 0, node,
+                                           reinterpret_cast<const void *>(node->Run));
+                        TResumeGuard guard{probe.get()};
+                        node->Run(node, false);
+                    } else {
+                        node->Run(node, false);
+                    }
+                } catch (...) {
+                    wake_pending_.store(true);
+                    Wake();  // the rest of the queue is taken by the next Poll()
+                    throw;
+                }
+            } else {
+                ready_events_.emplace_back(TEvent{-1, TEvent::READ, node->Handle});
+            }
+        }
+    }
+
+    /**
+     * @brief Resets the eventfd written by Wake().
+     */
+    void ConsumeWake() {
+        uint64_t value;
+        [[maybe_unused]] auto ret = read(wake_fd_, &value, sizeof(value));
+    }
+
     void ProcessTimers() {
         auto now = TClock::now();
-        bool first = true;
-        unsigned prev_id = 0;
-        while (!timers_.empty() && timers_.top().Deadline <= now) {
-            TTimer timer = timers_.top();
-            std::cout << "timer id: " << timer.Id << std::endl;
-            timers_.pop();
-            if ((first || prev_id != timer.Id) && timer.Handle) {
-                last_fired_timer_ = timer.Id;
-                timer.Handle.resume();
-            }
-            first = false;
-            prev_id = timer.Id;
+        timers_.Advance(now);
+        // timers added by the resumed coroutines fire on the next call
+        TTimerId id;
+        THandle handle;
+        while (timers_.PopExpired(&id, &handle)) {
+            TN_TRACE(trace_, Debug, TimerFire, id);
+            metrics_.TimersFired.Add();
+            Resume(handle, EStallSource::Timer, -1, 0, id);
         }
         last_timers_process_time_ = now;
     }
 
  protected:
-    int max_fd_;                          // max file descriptor in use
+    // around the blocking wait of Poll(): the wait is neither a slow step nor busy time
+    TTime BeginWait() {
+        auto now = TClock::now();
+        if (stall_probe_) {
+            stall_probe_->Idle(now);
+        }
+        return now;
+    }
+
+    void EndWait(TTime start) {
+        auto now = TClock::now();
+        metrics_.RecordWait(now - start);
+        if (stall_probe_) {
+            stall_probe_->Busy(now);
+        }
+    }
+
+    bool BusyPolling() const { return busy_poll_max_.count() != 0; }
+
+    // spins on @p poll, a wait that does not block, while the budget lasts and no timer
+    // is due; returns its last result: > 0 if it found events, < 0 on error
+    template <typename TFunc>
+    int Spin(TFunc&& poll) {
+        if (!busy_poll_budget_.count()) {
+            return 0;
+        }
+        auto start = TClock::now();
+        auto until = start + busy_poll_budget_;
+        if (!timers_.Empty()) {
+            until = std::min(until, timers_.NextDeadline());
+        }
+        int ret;
+        uint64_t polls = 0;
+        auto now = start;
+        do {
+            ret = poll();
+            ++polls;
+            now = TClock::now();
+        } while (ret == 0 && now < until);
+        metrics_.SpinNs.Add((now - start).count());
+        metrics_.SpinPolls.Add(polls);
+        (ret != 0 ? metrics_.SpinHits : metrics_.SpinMisses).Add();
+        return ret;
+    }
+
+    // after the blocking wait that followed a spin: @p waited is the time since the spin
+    // started, @p events tells if the wait ended with events
+    void AdaptBusyPoll(std::chrono::nanoseconds waited, bool events) {
+        if (!busy_poll_adaptive_ || !events) {
+            return;  // a timeout is a timer, spinning is not meant to catch it
+        }
+        if (waited <= busy_poll_max_) {
+            busy_poll_budget_ = busy_poll_budget_.count()
+                                    ? std::min(busy_poll_budget_ * 2, busy_poll_max_)
+                                    : busy_poll_max_ / 16;
+        } else {
+            busy_poll_budget_ /= 2;
+            if (busy_poll_budget_ < busy_poll_max_ / 16) {
+                busy_poll_budget_ = {};
+            }
+        }
+    }
+
+    struct TResumeGuard {
+        ~TResumeGuard() { Probe->EndResume(); }
+        TStallProbe *Probe;
+    };
+
+    void Resume(THandle h, EStallSource source, int fd, int type, TTimerId timerId) {
+        if (!stall_probe_) {
+            h.resume();
+            return;
+        }
+        auto probe = stall_probe_;  // the coroutine may unwatch the loop
+        probe->BeginResume(source, fd, type, timerId, h);
+        TResumeGuard guard{probe.get()};
+        h.resume();
+    }
+
+    int max_fd_ = 0;                      // max file descriptor in use
     std::vector<TEvent> changes_;         // events to be processed (registered events)
     std::vector<TEvent> ready_events_;    // events ready to wake up their coroutines
-    unsigned time_id_ = 0;                // counter for generating unique timer ids
-    std::priority_queue<TTimer> timers_;  // timers to be processed
+    TTimerWheel timers_;                  // timers to be processed
     TTime last_timers_process_time_;      // time of the last timers processing
-    unsigned last_fired_timer_ = -1;      // id of the last fired timer
     std::chrono::milliseconds max_duration_ = std::chrono::milliseconds(100);  // max poll duration
 
     timespec max_duration_ts_ = GetMaxDuration(max_duration_);  // max poll duration in timespec
+    TTraceRing trace_;                                          // binary trace of this loop
+    TLoopMetrics metrics_;                                      // counters of this loop
+    std::shared_ptr<TStallProbe> stall_probe_;                  // see TLoopWatchdog
+    std::vector<TDeferredFlush*> deferred_flushes_;             // see FlushDeferred()
+    std::vector<TDeferredFlush*> flushing_;                     // taken by FlushDeferred()
+    std::unique_ptr<TBufferPool> buffer_pool_;                  // see BufferPool()
+    std::chrono::nanoseconds busy_poll_max_{0};     // see SetBusyPoll(), 0: always block
+    std::chrono::nanoseconds busy_poll_budget_{0};  // current spin budget
+    bool busy_poll_adaptive_ = true;
+    bool disarm_on_wakeup_ = true;  // one-shot registrations: disarm an fd nobody waits for again
+
+    int wake_fd_;                            // eventfd written by other threads to wake Poll()
+    TMpscQueue<TRemoteNode> remote_;         // nodes pushed by other threads
+    std::atomic<bool> wake_pending_ = false;  // eventfd written since the last ProcessRemote()
+    std::atomic<int> remote_producers_ = 0;   // PushRemote() calls in progress
 };
+
+/**
+ * @brief Moves the awaiting coroutine to the thread running @p poller.
+ *
+ * Example: co_await ResumeOn(otherLoop.Poller());
+ */
+inline auto ResumeOn(TPollerBase& poller) {
+    struct TAwaitable {
+        bool await_ready() { return false; }
+
+        void await_suspend(std::coroutine_handle<> h) {
+            node.Handle = h;
+            poller->PushRemote(&node);
+        }
+
+        void await_resume() {}
+
+        TPollerBase* poller;
+        TRemoteNode node;
+    };
+    return TAwaitable{&poller, {}};
+}
 }  // namespace NNet
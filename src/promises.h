@@ -1,6 +1,8 @@
 #pragma once
 #include <coroutine>
 
+#include "framepool.h"
+
 namespace NNet {
 struct TVoidPromise;
 
@@ -8,7 +10,7 @@ struct TVoidTask : std::coroutine_handle<TVoidPromise> {
     using promise_type = TVoidPromise;
 };
 
-struct TVoidPromise {
+struct TVoidPromise : TPooledFrame {
     TVoidTask get_return_object() { return {TVoidTask::from_promise(*this)}; }
     std::suspend_never initial_suspend() { return {}; }
     std::suspend_never final_suspend() noexcept { return {}; }
@@ -22,7 +24,7 @@ struct TVoidSuspendedTask : std::coroutine_handle<TVoidSuspendedPromise> {
     using promise_type = TVoidSuspendedPromise;
 };
 
-struct TVoidSuspendedPromise {
+struct TVoidSuspendedPromise : TPooledFrame {
     TVoidSuspendedTask get_return_object() { return {TVoidSuspendedTask::from_promise(*this)}; }
     std::suspend_never initial_suspend() { return {}; }
     std::suspend_always final_suspend() noexcept { return {}; }
@@ -0,0 +1,554 @@
+#include "resolver.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string_view>
+
+#include "socket.h"
+#include "sockutils.h"
+
+namespace NNet {
+
+namespace {
+
+constexpr uint16_t TypeA = 1;
+constexpr uint16_t TypeSoa = 6;
+constexpr uint16_t TypeAaaa = 28;
+constexpr uint16_t ClassIn = 1;
+constexpr int RcodeNxDomain = 3;
+constexpr size_t UdpSize = 512;  // no EDNS, larger replies are truncated and go over TCP
+
+// the answers of one reply
+struct TReply {
+    int Rcode = 0;
+    bool Truncated = false;
+    std::vector<TAddress> Addrs;
+    std::optional<uint32_t> Ttl;          // lowest of the answer records
+    std::optional<uint32_t> NegativeTtl;  // of the SOA record of an empty answer
+};
+
+// closes the socket however the coroutine that owns it ends
+struct TSocketCloser {
+    ~TSocketCloser() { Socket.Close(); }
+
+    TSocket& Socket;
+};
+
+class TMessageReader {
+ public:
+    explicit TMessageReader(std::string_view msg) : msg_(msg) {}
+
+    bool U16(uint16_t* v) {
+        if (pos_ + 2 > msg_.size()) {
+            return false;
+        }
+        *v = uint8_t(msg_[pos_]) << 8 | uint8_t(msg_[pos_ + 1]);
+        pos_ += 2;
+        return true;
+    }
+
+    bool U32(uint32_t* v) {
+        uint16_t hi, lo;
+        if (!U16(&hi) || !U16(&lo)) {
+            return false;
+        }
+        *v = uint32_t(hi) << 16 | lo;
+        return true;
+    }
+
+    /**
+     * @brief Reads a name in lower case and dot separated, following compression pointers.
+     */
+    bool Name(std::string* name) {
+        name->clear();
+        size_t pos = pos_;
+        bool jumped = false;
+        for (int jumps = 0; jumps < 64;) {
+            if (pos >= msg_.size()) {
+                return false;
+            }
+            uint8_t len = msg_[pos];
+            if ((len & 0xC0) == 0xC0) {
+                if (pos + 1 >= msg_.size()) {
+                    return false;
+                }
+                if (!jumped) {
+                    pos_ = pos + 2;
+                    jumped = true;
+                }
+                pos = (len & 0x3F) << 8 | uint8_t(msg_[pos + 1]);
+                ++jumps;
+                continue;
+            }
+            if (len & 0xC0) {
+                return false;
+            }
+            if (len == 0) {
+                if (!jumped) {
+                    pos_ = pos + 1;
+                }
+                return true;
+            }
+            if (pos + 1 + len > msg_.size()) {
+                return false;
+            }
+            if (!name->empty()) {
+                name->push_back('.');
+            }
+            for (size_t i = pos + 1; i <= pos + len; ++i) {
+                name->push_back(std::tolower(static_cast<unsigned char>(msg_[i])));
+            }
+            pos += 1 + len;
+        }
+        return false;  // a pointer loop
+    }
+
+    bool Skip(size_t size) {
+        if (pos_ + size > msg_.size()) {
+            return false;
+        }
+        pos_ += size;
+        return true;
+    }
+
+    const char* Data() const { return msg_.data() + pos_; }
+
+    size_t Pos() const { return pos_; }
+
+ private:
+    std::string_view msg_;
+    size_t pos_ = 0;
+};
+
+std::string MakeQuery(uint16_t id, const std::string& name, uint16_t type) {
+    std::string query;
+    auto u16 = [&](uint16_t v) {
+        query.push_back(char(v >> 8));
+        query.push_back(char(v & 0xFF));
+    };
+    u16(id);
+    u16(0x0100);  // a standard query, recursion desired
+    u16(1);       // one question
+    u16(0);
+    u16(0);
+    u16(0);
+    size_t start = 0;
+    while (start <= name.size()) {
+        auto end = std::min(name.find('.', start), name.size());
+        query.push_back(char(end - start));
+        query.append(name, start, end - start);
+        start = end + 1;
+    }
+    query.push_back(0);
+    u16(type);
+    u16(ClassIn);
+    return query;
+}
+
+/**
+ * @brief Parses the reply to the query @p id of @p name, false if it is malformed or
+ * answers another question.
+ */
+bool ParseReply(std::string_view msg, uint16_t id, const std::string& name, uint16_t type,
+                TReply* reply) {
+    TMessageReader reader(msg);
+    uint16_t replyId, flags, questions, answers, authorities, additional;
+    if (!reader.U16(&replyId) || !reader.U16(&flags) || !reader.U16(&questions) ||
+        !reader.U16(&answers) || !reader.U16(&authorities) || !reader.U16(&additional)) {
+        return false;
+    }
+    if (replyId != id || !(flags & 0x8000) || questions != 1) {
+        return false;
+    }
+    reply->Rcode = flags & 0x0F;
+    reply->Truncated = flags & 0x0200;
+    std::string owner;
+    uint16_t qtype, qclass;
+    if (!reader.Name(&owner) || !reader.U16(&qtype) || !reader.U16(&qclass)) {
+        return reply->Truncated;  // the sections may be cut anywhere, the TCP reply has them
+    }
+    if (owner != name || qtype != type || qclass != ClassIn) {
+        return false;
+    }
+    if (reply->Truncated) {
+        return true;
+    }
+    for (int i = 0; i < answers + authorities; ++i) {
+        uint16_t rtype, rclass, size;
+        uint32_t ttl;
+        if (!reader.Name(&owner) || !reader.U16(&rtype) || !reader.U16(&rclass) ||
+            !reader.U32(&ttl) || !reader.U16(&size)) {
+            return false;
+        }
+        if (ttl > INT32_MAX) {
+            ttl = 0;  // RFC 2181: a TTL with the top bit set means 0
+        }
+        auto data = reader.Data();
+        auto next = reader.Pos() + size;
+        if (!reader.Skip(size)) {
+            return false;
+        }
+        if (i >= answers) {
+            // SOA of an empty answer: the negative TTL is the lower of its TTL and MINIMUM
+            if (rtype == TypeSoa && reply->Addrs.empty()) {
+                TMessageReader soa(msg);
+                std::string skipped;
+                uint32_t minimum;
+                if (soa.Skip(next - size) && soa.Name(&skipped) && soa.Name(&skipped) &&
+                    soa.Skip(16) && soa.U32(&minimum) && soa.Pos() <= next) {
+                    reply->NegativeTtl = std::min(ttl, minimum);
+                }
+            }
+            continue;
+        }
+        // CNAME records of the chain only count for the TTL
+        reply->Ttl = std::min(ttl, reply->Ttl.value_or(ttl));
+        if (rclass != ClassIn || rtype != type) {
+            continue;
+        }
+        if (type == TypeA && size == 4) {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            memcpy(&addr.sin_addr, data, 4);
+            reply->Addrs.emplace_back(addr);
+        } else if (type == TypeAaaa && size == 16) {
+            sockaddr_in6 addr{};
+            addr.sin6_family = AF_INET6;
+            memcpy(&addr.sin6_addr, data, 16);
+            reply->Addrs.emplace_back(addr);
+        }
+    }
+    return true;
+}
+
+// an IPv4 or IPv6 literal, scoped IPv6 addresses are left to getaddrinfo()
+std::optional<TAddress> ParseLiteral(const std::string& name) {
+    sockaddr_in addr{};
+    if (inet_pton(AF_INET, name.c_str(), &addr.sin_addr) == 1) {
+        addr.sin_family = AF_INET;
+        return TAddress{addr};
+    }
+    sockaddr_in6 addr6{};
+    if (inet_pton(AF_INET6, name.c_str(), &addr6.sin6_addr) == 1) {
+        addr6.sin6_family = AF_INET6;
+        return TAddress{addr6};
+    }
+    return std::nullopt;
+}
+
+// lower case without the trailing dot, throws on names that cannot be queried
+std::string Normalize(std::string name) {
+    if (!name.empty() && name.back() == '.') {
+        name.pop_back();
+    }
+    if (name.empty() || name.size() > 253) {
+        throw std::invalid_argument("Invalid host name: '" + name + "'");
+    }
+    size_t label = 0;
+    for (auto& c : name) {
+        c = std::tolower(static_cast<unsigned char>(c));
+        if (c == '.') {
+            if (label == 0) {
+                throw std::invalid_argument("Invalid host name: '" + name + "'");
+            }
+            label = 0;
+        } else if (++label > 63) {
+            throw std::invalid_argument("Invalid host name: '" + name + "'");
+        }
+    }
+    if (label == 0) {
+        throw std::invalid_argument("Invalid host name: '" + name + "'");
+    }
+    return name;
+}
+
+}  // namespace
+
+// fails the waiters of a query whose leader is destroyed before it finished
+struct TResolver::TInflightGuard {
+    ~TInflightGuard() {
+        if (!Inflight->Done) {
+            Inflight->Error = std::make_exception_ptr(std::runtime_error("DNS query cancelled"));
+            Resolver->Finish(Name, Inflight);
+        }
+    }
+
+    TResolver* Resolver;
+    const std::string& Name;
+    std::shared_ptr<TInflight> Inflight;
+};
+
+TResolver::TResolver(TPollerBase& poller) : TResolver(poller, TOptions()) {}
+
+TResolver::TResolver(TPollerBase& poller, TOptions options)
+    : poller_(poller),
+      options_(std::move(options)),
+      nameservers_(options_.Nameservers),
+      random_(std::random_device{}()) {
+    if (nameservers_.empty()) {
+        LoadResolvConf(options_.ResolvConf);
+    }
+    if (!options_.HostsFile.empty()) {
+        LoadHosts(options_.HostsFile);
+    }
+}
+
+TFuture<std::vector<TAddress>> TResolver::Resolve(std::string name, int port) {
+    if (auto literal = ParseLiteral(name)) {
+        co_return std::vector<TAddress>{literal->WithPort(port)};
+    }
+    name = Normalize(std::move(name));
+    std::vector<TAddress> addrs;
+    if (auto it = hosts_.find(name); it != hosts_.end()) {
+        ++stats_.HostsHits;
+        addrs = it->second;
+    } else if (auto* cached = FindCached(name)) {
+        ++stats_.CacheHits;
+        addrs = *cached;
+    } else {
+        addrs = co_await Shared(name);
+    }
+    for (auto& addr : addrs) {
+        addr = addr.WithPort(port);
+    }
+    co_return addrs;
+}
+
+TFuture<std::vector<TAddress>> TResolver::Shared(std::string name) {
+    struct TJoin {
+        bool await_ready() { return Inflight->Done; }
+
+        void await_suspend(std::coroutine_handle<> h) { Inflight->Waiters.push_back(h); }
+
+        void await_resume() {
+            if (Inflight->Error) {
+                std::rethrow_exception(Inflight->Error);
+            }
+        }
+
+        TInflight* Inflight;
+    };
+
+    if (auto it = inflight_.find(name); it != inflight_.end()) {
+        ++stats_.Coalesced;
+        auto inflight = it->second;
+        co_await TJoin{inflight.get()};
+        co_return inflight->Addrs;
+    }
+
+    auto inflight = std::make_shared<TInflight>();
+    inflight_.emplace(name, inflight);
+    TInflightGuard guard{this, name, inflight};
+    ++stats_.Queries;
+    try {
+        auto result = co_await QueryServers(name);
+        Store(name, result);
+        inflight->Addrs = std::move(result.Addrs);
+    } catch (...) {
+        inflight->Error = std::current_exception();
+    }
+    Finish(name, inflight);
+    co_await TJoin{inflight.get()};
+    co_return inflight->Addrs;
+}
+
+TFuture<TResolver::TResult> TResolver::QueryServers(std::string name) {
+    std::exception_ptr error;
+    for (int attempt = 0; attempt < options_.Attempts; ++attempt) {
+        for (const auto& nameserver : nameservers_) {
+            try {
+                auto result = co_await Exchange(nameserver, name);
+                co_return result;
+            } catch (const std::exception&) {
+                // a timeout, a refused port or a server error: the next one may answer
+                error = std::current_exception();
+            }
+        }
+    }
+    if (!error) {
+        throw std::logic_error("No DNS query attempts");
+    }
+    std::rethrow_exception(error);
+}
+
+TFuture<TResolver::TResult> TResolver::Exchange(TAddress nameserver, std::string name) {
+    auto deadline = TClock::now() + options_.Timeout;
+    std::vector<uint16_t> types{TypeA};
+    if (options_.Ipv6) {
+        types.push_back(TypeAaaa);
+    }
+    std::vector<uint16_t> ids;
+    std::vector<std::string> queries;
+    for (auto type : types) {
+        ids.push_back(static_cast<uint16_t>(random_()));
+        queries.push_back(MakeQuery(ids.back(), name, type));
+    }
+
+    TSocket socket(poller_, nameserver.Domain(), SOCK_DGRAM);
+    TSocketCloser closer{socket};
+    co_await socket.Connect(nameserver, deadline);
+    for (const auto& query : queries) {
+        while (true) {
+            auto size = co_await socket.WriteSome(query.data(), query.size(), deadline);
+            if (size >= 0) {
+                break;
+            }
+        }
+    }
+
+    std::vector<std::optional<TReply>> replies(types.size());
+    size_t pending = types.size();
+    char buf[UdpSize];
+    while (pending != 0) {
+        auto size = co_await socket.ReadSome(buf, sizeof(buf), deadline);
+        if (size <= 0) {
+            continue;
+        }
+        // replies to other queries, late ones from an earlier attempt included, are dropped
+        for (size_t i = 0; i < types.size(); ++i) {
+            TReply reply;
+            if (replies[i] ||
+                !ParseReply(std::string_view(buf, size), ids[i], name, types[i], &reply)) {
+                continue;
+            }
+            if (reply.Truncated) {
+                ++stats_.TcpRetries;
+                auto message = co_await ExchangeTcp(nameserver, queries[i], deadline);
+                reply = TReply{};
+                if (!ParseReply(message, ids[i], name, types[i], &reply) || reply.Truncated) {
+                    throw std::runtime_error("Malformed DNS reply over TCP");
+                }
+            }
+            if (reply.Rcode != 0 && reply.Rcode != RcodeNxDomain) {
+                throw std::runtime_error("DNS server error, rcode " + std::to_string(reply.Rcode));
+            }
+            replies[i] = std::move(reply);
+            --pending;
+            break;
+        }
+    }
+
+    // IPv4 first; an answer without a TTL to cache it for makes the result uncacheable
+    TResult result;
+    std::optional<uint32_t> ttl;
+    for (auto& reply : replies) {
+        uint32_t replyTtl = 0;
+        if (!reply->Addrs.empty()) {
+            replyTtl = std::min<uint32_t>(*reply->Ttl, options_.MaxTtl.count());
+        } else if (reply->NegativeTtl) {
+            replyTtl = std::min<uint32_t>(*reply->NegativeTtl, options_.MaxNegativeTtl.count());
+        }
+        ttl = std::min(replyTtl, ttl.value_or(replyTtl));
+        result.Addrs.insert(result.Addrs.end(), reply->Addrs.begin(), reply->Addrs.end());
+    }
+    result.Ttl = ttl.value_or(0);
+    co_return result;
+}
+
+TFuture<std::string> TResolver::ExchangeTcp(TAddress nameserver, std::string query,
+                                            TTime deadline) {
+    TSocket socket(poller_, nameserver.Domain());
+    TSocketCloser closer{socket};
+    co_await socket.Connect(nameserver, deadline);
+    std::string request(2, '\0');
+    request[0] = char(query.size() >> 8);
+    request[1] = char(query.size() & 0xFF);
+    request += query;
+    co_await TByteWriter<TSocket>(socket).Write(request.data(), request.size(), deadline);
+    uint8_t header[2];
+    co_await TByteReader<TSocket>(socket).Read(header, sizeof(header), deadline);
+    std::string reply(header[0] << 8 | header[1], '\0');
+    co_await TByteReader<TSocket>(socket).Read(reply.data(), reply.size(), deadline);
+    co_return reply;
+}
+
+const std::vector<TAddress>* TResolver::FindCached(const std::string& name) {
+    auto it = cache_.find(name);
+    if (it == cache_.end()) {
+        return nullptr;
+    }
+    if (it->second.Expires <= TClock::now()) {
+        cache_.erase(it);
+        return nullptr;
+    }
+    return &it->second.Addrs;
+}
+
+void TResolver::Store(const std::string& name, const TResult& result) {
+    if (result.Ttl == 0 || options_.MaxCacheSize == 0) {
+        return;
+    }
+    auto now = TClock::now();
+    if (cache_.size() >= options_.MaxCacheSize && !cache_.contains(name)) {
+        std::erase_if(cache_, [&](const auto& entry) { return entry.second.Expires <= now; });
+        if (cache_.size() >= options_.MaxCacheSize) {
+            cache_.erase(cache_.begin());
+        }
+    }
+    cache_[name] = TCacheEntry{result.Addrs, now + std::chrono::seconds(result.Ttl)};
+}
+
+void TResolver::Finish(const std::string& name, const std::shared_ptr<TInflight>& inflight) {
+    inflight->Done = true;
+    if (auto it = inflight_.find(name); it != inflight_.end() && it->second == inflight) {
+        inflight_.erase(it);
+    }
+    // the waiters resume on the next Poll(), after the leader
+    for (auto h : std::exchange(inflight->Waiters, {})) {
+        poller_.AddTimer(TTime{}, h);
+    }
+}
+
+void TResolver::LoadHosts(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string ip, name;
+        if (!(fields >> ip)) {
+            continue;
+        }
+        auto addr = ParseLiteral(ip);
+        if (!addr || (addr->Domain() == AF_INET6 && !options_.Ipv6)) {
+            continue;
+        }
+        while (fields >> name) {
+            try {
+                auto& addrs = hosts_[Normalize(name)];
+                // IPv4 first, as for the answers of the nameservers
+                auto pos = addr->Domain() == AF_INET
+                               ? std::find_if(addrs.begin(), addrs.end(),
+                                              [](auto& a) { return a.Domain() == AF_INET6; })
+                               : addrs.end();
+                if (std::find(addrs.begin(), addrs.end(), *addr) == addrs.end()) {
+                    addrs.insert(pos, *addr);
+                }
+            } catch (const std::invalid_argument&) {
+                // not a host name
+            }
+        }
+    }
+}
+
+void TResolver::LoadResolvConf(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string keyword, ip;
+        if (fields >> keyword >> ip && keyword == "nameserver") {
+            if (auto addr = ParseLiteral(ip)) {
+                nameservers_.push_back(addr->WithPort(53));
+            }
+        }
+    }
+    if (nameservers_.empty()) {
+        nameservers_.emplace_back("127.0.0.1", 53);
+    }
+}
+
+}  // namespace NNet
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "address.h"
+#include "base.h"
+#include "corochain.h"
+#include "poller.h"
+
+namespace NNet {
+
+/**
+ * @class TResolver
+ * @brief Asynchronous DNS resolver of one loop, A and AAAA queries over UDP with a cache.
+ *
+ * A name is looked up in the hosts file, then in the cache, then queried from the
+ * nameservers in turn: A and AAAA in parallel from one UDP socket, over TCP when a reply
+ * is truncated. Answers are cached for their TTL, names without addresses for the
+ * negative TTL of their SOA record. Concurrent Resolve() calls of one name share one query.
+ * Names are queried as given, without the search list of resolv.conf. The resolver must
+ * outlive its queries.
+ *
+ * Example:
+ * @code
+ * TResolver resolver(loop.Poller());
+ * auto addrs = co_await resolver.Resolve("example.com", 80);
+ * co_await socket.Connect(addrs.at(0));
+ * @endcode
+ */
+class TResolver {
+ public:
+    struct TOptions {
+        std::vector<TAddress> Nameservers;            // empty: the ones of ResolvConf
+        std::string ResolvConf = "/etc/resolv.conf";  // 127.0.0.1 if it has no nameserver
+        std::string HostsFile = "/etc/hosts";         // empty: no hosts file
+        std::chrono::milliseconds Timeout{2000};      // for the replies of one nameserver
+        int Attempts = 2;                             // rounds over the nameservers
+        bool Ipv6 = true;                             // AAAA queries too
+        std::chrono::seconds MaxTtl{3600};            // caps the TTLs of the answers
+        std::chrono::seconds MaxNegativeTtl{300};
+        size_t MaxCacheSize = 10000;                  // names, expired ones are dropped first
+    };
+
+    struct TStats {
+        uint64_t Queries = 0;    // names sent to the nameservers
+        uint64_t CacheHits = 0;
+        uint64_t HostsHits = 0;
+        uint64_t Coalesced = 0;  // Resolve() calls that joined a query in flight
+        uint64_t TcpRetries = 0; // truncated replies queried again over TCP
+    };
+
+    explicit TResolver(TPollerBase& poller);
+    TResolver(TPollerBase& poller, TOptions options);
+
+    TResolver(const TResolver&) = delete;
+    TResolver& operator=(const TResolver&) = delete;
+
+    /**
+     * @brief Addresses of @p name with @p port, IPv4 first, empty if the name has none.
+     *
+     * An IP literal is returned as is. Throws TTimeoutError if no nameserver replies,
+     * std::runtime_error on server errors and std::invalid_argument on a malformed name.
+     */
+    TFuture<std::vector<TAddress>> Resolve(std::string name, int port = 0);
+
+    const std::vector<TAddress>& Nameservers() const { return nameservers_; }
+
+    TStats Stats() const { return stats_; }
+
+ private:
+    // the answers for a name, from one nameserver
+    struct TResult {
+        std::vector<TAddress> Addrs;
+        uint32_t Ttl = 0;  // seconds
+    };
+
+    struct TCacheEntry {
+        std::vector<TAddress> Addrs;
+        TTime Expires;
+    };
+
+    // a query in flight, shared by the Resolve() calls of its name
+    struct TInflight {
+        std::vector<THandle> Waiters;
+        std::vector<TAddress> Addrs;
+        std::exception_ptr Error;
+        bool Done = false;
+    };
+
+    struct TInflightGuard;
+
+    TFuture<std::vector<TAddress>> Shared(std::string name);
+    TFuture<TResult> QueryServers(std::string name);
+    TFuture<TResult> Exchange(TAddress nameserver, std::string name);
+    TFuture<std::string> ExchangeTcp(TAddress nameserver, std::string query, TTime deadline);
+
+    const std::vector<TAddress>* FindCached(const std::string& name);
+    void Store(const std::string& name, const TResult& result);
+    void Finish(const std::string& name, const std::shared_ptr<TInflight>& inflight);
+    void LoadHosts(const std::string& path);
+    void LoadResolvConf(const std::string& path);
+
+    TPollerBase& poller_;
+    TOptions options_;
+    std::vector<TAddress> nameservers_;
+    std::unordered_map<std::string, std::vector<TAddress>> hosts_;
+    std::unordered_map<std::string, TCacheEntry> cache_;
+    std::unordered_map<std::string, std::shared_ptr<TInflight>> inflight_;
+    std::mt19937 random_;  // query ids
+    TStats stats_;
+};
+
+}  // namespace NNet
@@ -0,0 +1,84 @@
+#include <string.h>
+#include <cstdint>
+#include "scan.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace NNet {
+
+namespace {
+
+void ScanScalar(const char* data, size_t size, char delimiter, size_t base,
+                std::vector<size_t>& out) {
+    const char* p = data;
+    const char* end = data + size;
+    while (p != end && (p = static_cast<const char*>(memchr(p, delimiter, end - p)))) {
+        out.push_back(base + (p - data));
+        ++p;
+    }
+}
+
+#if defined(__x86_64__)
+void PushMask(uint32_t mask, size_t offset, std::vector<size_t>& out) {
+    while (mask) {
+        out.push_back(offset + __builtin_ctz(mask));
+        mask &= mask - 1;
+    }
+}
+
+void ScanSse2(const char* data, size_t size, char delimiter, size_t base,
+              std::vector<size_t>& out) {
+    auto needle = _mm_set1_epi8(delimiter);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        PushMask(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)), base + i, out);
+    }
+    ScanScalar(data + i, size - i, delimiter, base + i, out);
+}
+
+__attribute__((target("avx2"))) void ScanAvx2(const char* data, size_t size, char delimiter,
+                                              size_t base, std::vector<size_t>& out) {
+    auto needle = _mm256_set1_epi8(delimiter);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        PushMask(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)), base + i, out);
+    }
+    ScanSse2(data + i, size - i, delimiter, base + i, out);
+}
+#endif
+
+EScanLevel DetectScanLevel() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? EScanLevel::Avx2 : EScanLevel::Sse2;
+#else
+    return EScanLevel::Scalar;
+#endif
+}
+
+}  // namespace
+
+EScanLevel BestScanLevel() {
+    static const EScanLevel level = DetectScanLevel();
+    return level;
+}
+
+void ScanDelimiters(const char* data, size_t size, char delimiter, size_t base,
+                    std::vector<size_t>& out, EScanLevel level) {
+    switch (level) {
+#if defined(__x86_64__)
+    case EScanLevel::Avx2:
+        return ScanAvx2(data, size, delimiter, base, out);
+    case EScanLevel::Sse2:
+        return ScanSse2(data, size, delimiter, base, out);
+#endif
+    default:
+        return ScanScalar(data, size, delimiter, base, out);
+    }
+}
+
+}  // namespace NNet
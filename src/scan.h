@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace NNet {
+
+enum class EScanLevel {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+/**
+ * @brief The widest implementation of ScanDelimiters() the CPU supports, detected once.
+ */
+EScanLevel BestScanLevel();
+
+/**
+ * @brief Appends @p base + offset of every @p delimiter in [@p data, @p data + @p size) to @p out.
+ *
+ * One pass over the chunk, 16 (SSE2) or 32 (AVX2) bytes per compare.
+ */
+void ScanDelimiters(const char* data, size_t size, char delimiter, size_t base,
+                    std::vector<size_t>& out, EScanLevel level = BestScanLevel());
+
+}  // namespace NNet
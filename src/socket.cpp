@@ -1,4 +1,6 @@
 
+#include <time.h>
+#include <linux/errqueue.h>
 #include "socket.h"
 
 namespace NNet {
@@ -54,6 +56,114 @@ void TSocket::Bind(const TAddress& addr) {
     }
 }
 
+void TSocket::SetReusePort(bool enable) {
+    int optval = enable;
+    if (setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0) {
+        throw std::system_error(errno, std::generic_category(), "setsockopt SO_REUSEPORT");
+    }
+}
+
+bool TSocket::SetBusyPoll(std::chrono::microseconds timeout, bool prefer) {
+    auto refused = [] { return errno == EPERM || errno == ENOPROTOOPT || errno == EINVAL; };
+    int optval = static_cast<int>(timeout.count());
+    if (setsockopt(fd_, SOL_SOCKET, SO_BUSY_POLL, &optval, sizeof(optval)) < 0) {
+        if (refused()) {
+            return false;
+        }
+        throw std::system_error(errno, std::generic_category(), "setsockopt SO_BUSY_POLL");
+    }
+    if (!prefer) {
+        return true;
+    }
+#ifdef SO_PREFER_BUSY_POLL
+    optval = 1;
+    if (setsockopt(fd_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &optval, sizeof(optval)) < 0) {
+        if (refused()) {
+            return false;
+        }
+        throw std::system_error(errno, std::generic_category(),
+                                "setsockopt SO_PREFER_BUSY_POLL");
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+int TFileHandle::Open(const char* path, int flags) {
+    int fd = ::open(path, flags | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), std::string("open ") + path);
+    }
+    return fd;
+}
+
+off_t TFileHandle::Size() const {
+    struct stat st;
+    if (fstat(fd_, &st) < 0) {
+        throw std::system_error(errno, std::generic_category(), "fstat");
+    }
+    return st.st_size;
+}
+
+bool TSocket::EnableZeroCopy(size_t minSize) {
+    int optval = 1;
+    if (setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) < 0) {
+        if (errno == ENOPROTOOPT || errno == EOPNOTSUPP || errno == EINVAL) {
+            return false;
+        }
+        throw std::system_error(errno, std::generic_category(), "setsockopt SO_ZEROCOPY");
+    }
+    if (!zerocopy_) {
+        zerocopy_ = std::make_unique<TZeroCopyState>();
+    }
+    zerocopy_->MinSize = minSize;
+    return true;
+}
+
+bool TSocket::ReapZeroCopy(int fd, TZeroCopyState* state) {
+    bool reaped = false;
+    while (true) {
+        char control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+        msghdr msg = {};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!(errno == EAGAIN || errno == EWOULDBLOCK)) {
+                throw std::system_error(errno, std::generic_category(), "recvmsg MSG_ERRQUEUE");
+            }
+            break;
+        }
+        for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            auto* err = reinterpret_cast<sock_extended_err*>(CMSG_DATA(cmsg));
+            if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            // sends ee_info..ee_data (inclusive) are done
+            state->Completed += err->ee_data - err->ee_info + 1;
+            if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                state->Copied = true;
+            }
+            reaped = true;
+        }
+    }
+    if (!reaped) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error != 0) {
+            throw std::system_error(error, std::generic_category(), "Socket operation failed");
+        }
+    }
+    return reaped;
+}
+
 void TSocket::Listen(int backlog) {
     if (listen(fd_, backlog) < 0) {
         throw std::system_error(errno, std::generic_category(), "listen");
@@ -5,22 +5,37 @@
 #include <asm-generic/errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <coroutine>
+#include <memory>
 #include <optional>
+#include <span>
 #include <stdexcept>
+#include <utility>
 #include <variant>
 
 #include "address.h"
 #include "base.h"
+#include "corochain.h"
 #include "poller.h"
 
 namespace NNet {
+
+/**
+ * @brief Marks an fd that is already a non-blocking socket (e.g. from accept4), Setup() is skipped.
+ */
+struct TNoSetup {};
+
 template <typename T>
 class TSocketBase;
 
@@ -29,15 +44,48 @@ class TSocketBase<void> {
  public:
     TPollerBase* Poller() { return poller_; }
 
+    int Fd() const { return fd_; }
+
  protected:
     TSocketBase() = default;
     TSocketBase(TPollerBase& poller, int domain, int type);
     TSocketBase(int fd, TPollerBase& poller);
+    TSocketBase(int fd, TPollerBase& poller, TNoSetup) : poller_(&poller), fd_(fd) {}
 
     int Create(int domain, int type);
 
     int Setup(int s);
 
+    /**
+     * @brief Awaitable @p T waiting for @p Type events, bounded by a deadline.
+     *
+     * The timer is armed only when the operation has to wait, an operation that
+     * completes at once costs a comparison. On expiry the wait is removed from the
+     * poller and TTimeoutError is thrown.
+     */
+    template <typename T, int Type>
+    struct TTimedAwaitable : T {
+        void await_suspend(std::coroutine_handle<> h) {
+            T::await_suspend(h);
+            if (deadline != TTime::max()) {
+                handle = h;
+                timer_id = this->poller->AddTimer(deadline, h);
+            }
+        }
+
+        decltype(auto) await_resume() {
+            if (handle && this->poller->RemoveTimer(timer_id)) {
+                this->poller->RemoveWait(this->fd, Type, handle);
+                throw TTimeoutError("Socket operation timeout");
+            }
+            return T::await_resume();
+        }
+
+        TTime deadline = TTime::max();
+        THandle handle = {};
+        TTimerId timer_id = 0;
+    };
+
     TPollerBase* poller_ = nullptr;
     int fd_ = -1;
 };
@@ -49,7 +97,8 @@ class TSocketBase : public TSocketBase<void> {
         struct TAwaitableRead : TAwaitable<TAwaitableRead> {
             void run() {
                 this->ret = TSockOps::read(this->fd, this->b, this->s);
-                std::cout << "fd: " << this->fd << ", read ret: " << this->ret << std::endl;
+                TN_TRACE(this->poller->Trace(), Debug, SocketRead, this->fd, this->ret);
+                this->poller->Metrics().CountRead(this->ret);
             }
 
             void await_suspend(std::coroutine_handle<> handle) {
@@ -59,6 +108,14 @@ class TSocketBase : public TSocketBase<void> {
         return TAwaitableRead{poller_, fd_, buf, size};
     }
 
+    /**
+     * @brief ReadSome() that throws TTimeoutError if nothing arrives before @p deadline.
+     */
+    auto ReadSome(void* buf, size_t size, TTime deadline) {
+        auto op = ReadSome(buf, size);
+        return TTimedAwaitable<decltype(op), TEvent::READ>{op, deadline};
+    }
+
     auto ReadSomeYield(void* buf, size_t size) {
         struct TAwaitableRead : TAwaitable<TAwaitableRead> {
             bool await_ready() { return (this->ready = false); }
@@ -67,7 +124,8 @@ class TSocketBase : public TSocketBase<void> {
             }
             void run() {
                 this->ret = TSockOps::read(this->fd, this->b, this->s);
-                std::cout << "fd: " << this->fd << ", yield read ret: " << this->ret << std::endl;
+                TN_TRACE(this->poller->Trace(), Debug, SocketReadYield, this->fd, this->ret);
+                this->poller->Metrics().CountRead(this->ret);
             }
         };
         return TAwaitableRead{poller_, fd_, buf, size};
@@ -77,7 +135,8 @@ class TSocketBase : public TSocketBase<void> {
         struct TAwaitableWrite : public TAwaitable<TAwaitableWrite> {
             void run() {
                 this->ret = TSockOps::write(this->fd, this->b, this->s);
-                std::cout << "fd: " << this->fd << ", write ret: " << this->ret << std::endl;
+                TN_TRACE(this->poller->Trace(), Debug, SocketWrite, this->fd, this->ret);
+                this->poller->Metrics().CountWrite(this->ret);
             }
 
             void await_suspend(std::coroutine_handle<> h) { this->poller->AddWrite(this->fd, h); }
@@ -85,13 +144,19 @@ class TSocketBase : public TSocketBase<void> {
         return TAwaitableWrite{poller_, fd_, const_cast<void*>(buf), size};
     }
 
+    auto WriteSome(const void* buf, size_t size, TTime deadline) {
+        auto op = WriteSome(buf, size);
+        return TTimedAwaitable<decltype(op), TEvent::WRITE>{op, deadline};
+    }
+
     auto WriteSomeYield(const void* buf, size_t size) {
         struct TAwaitableWrite : public TAwaitable<TAwaitableWrite> {
             bool await_ready() { return (this->ready = false); }
 
             void run() {
                 this->ret = TSockOps::write(this->fd, this->b, this->s);
-                std::cout << "fd: " << this->fd << ", yield write ret: " << this->ret << std::endl;
+                TN_TRACE(this->poller->Trace(), Debug, SocketWriteYield, this->fd, this->ret);
+                this->poller->Metrics().CountWrite(this->ret);
             }
 
             void await_suspend(std::coroutine_handle<> h) { this->poller->AddWrite(this->fd, h); }
@@ -99,8 +164,143 @@ class TSocketBase : public TSocketBase<void> {
         return TAwaitableWrite{poller_, fd_, const_cast<void*>(buf), size};
     }
 
+    /**
+     * @brief Scatter read into @p iov with one syscall, the result is the same as of ReadSome().
+     *
+     * The iovec array must stay alive until the awaitable completes.
+     */
+    auto ReadSomeV(std::span<const iovec> iov) {
+        struct TAwaitableRead : TAwaitable<TAwaitableRead> {
+            void run() {
+                this->ret = TSockOps::readv(this->fd, static_cast<const iovec*>(this->b), this->s);
+                TN_TRACE(this->poller->Trace(), Debug, SocketRead, this->fd, this->ret);
+                this->poller->Metrics().CountRead(this->ret);
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                this->poller->AddRead(this->fd, handle);
+            }
+        };
+        return TAwaitableRead{poller_, fd_, const_cast<iovec*>(iov.data()), iov.size()};
+    }
+
+    auto ReadSomeV(std::span<const iovec> iov, TTime deadline) {
+        auto op = ReadSomeV(iov);
+        return TTimedAwaitable<decltype(op), TEvent::READ>{op, deadline};
+    }
+
+    /**
+     * @brief Gather write of @p iov with one syscall, the result is the same as of WriteSome().
+     */
+    auto WriteSomeV(std::span<const iovec> iov) {
+        struct TAwaitableWrite : public TAwaitable<TAwaitableWrite> {
+            void run() {
+                this->ret = TSockOps::writev(this->fd, static_cast<const iovec*>(this->b), this->s);
+                TN_TRACE(this->poller->Trace(), Debug, SocketWrite, this->fd, this->ret);
+                this->poller->Metrics().CountWrite(this->ret);
+            }
+
+            void await_suspend(std::coroutine_handle<> h) { this->poller->AddWrite(this->fd, h); }
+        };
+        return TAwaitableWrite{poller_, fd_, const_cast<iovec*>(iov.data()), iov.size()};
+    }
+
+    auto WriteSomeV(std::span<const iovec> iov, TTime deadline) {
+        auto op = WriteSomeV(iov);
+        return TTimedAwaitable<decltype(op), TEvent::WRITE>{op, deadline};
+    }
+
+    /**
+     * @brief Waits until the descriptor is readable without reading anything.
+     *
+     * Lets a reader borrow its buffer only once there is data. The result is 1 when
+     * readable and -1 on a spurious wakeup, the caller waits again then.
+     */
+    auto WaitReadable() {
+        struct TAwaitableReadable : public TAwaitable<TAwaitableReadable> {
+            void run() {
+                pollfd p = {this->fd, POLLIN, 0};
+                this->ret = ::poll(&p, 1, 0);
+                if (this->ret == 0) {
+                    this->ret = -1;
+                    errno = EAGAIN;
+                }
+            }
+
+            void await_suspend(std::coroutine_handle<> h) { this->poller->AddRead(this->fd, h); }
+        };
+        return TAwaitableReadable{poller_, fd_};
+    }
+
+    auto WaitReadable(TTime deadline) {
+        auto op = WaitReadable();
+        return TTimedAwaitable<decltype(op), TEvent::READ>{op, deadline};
+    }
+
+    /**
+     * @brief One read() that never waits, -1 if nothing is available yet (EAGAIN).
+     *
+     * With WaitReadableYield() after -1 a read costs one syscall when data is ready and
+     * two around the wait otherwise, the readers borrow their buffer only for the read.
+     */
+    ssize_t TryReadSome(void* buf, size_t size) {
+        ssize_t ret;
+        do {
+            ret = TSockOps::read(fd_, buf, size);
+        } while (ret < 0 && errno == EINTR);
+        TN_TRACE(poller_->Trace(), Debug, SocketRead, fd_, ret);
+        poller_->Metrics().CountRead(ret);
+        if (ret < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                throw std::system_error(errno, std::generic_category(), "Socket operation failed");
+            }
+            poller_->Metrics().Again.Add();
+        }
+        return ret;
+    }
+
+    /**
+     * @brief WaitReadable() after a read got EAGAIN: waits at once, without the poll() probe.
+     *
+     * The wakeup may be spurious, the caller reads again.
+     */
+    auto WaitReadableYield(TTime deadline = TTime::max()) {
+        struct TAwaitableReadable : public TAwaitable<TAwaitableReadable> {
+            bool await_ready() { return (this->ready = false); }
+
+            void run() { this->ret = 0; }
+
+            void await_suspend(std::coroutine_handle<> h) { this->poller->AddRead(this->fd, h); }
+        };
+        auto op = TAwaitableReadable{poller_, fd_};
+        return TTimedAwaitable<decltype(op), TEvent::READ>{op, deadline};
+    }
+
+    /**
+     * @brief Waits until the descriptor is writable, results as of WaitReadable().
+     */
+    auto WaitWritable() {
+        struct TAwaitableWritable : public TAwaitable<TAwaitableWritable> {
+            void run() {
+                pollfd p = {this->fd, POLLOUT, 0};
+                this->ret = ::poll(&p, 1, 0);
+                if (this->ret == 0) {
+                    this->ret = -1;
+                    errno = EAGAIN;
+                }
+            }
+
+            void await_suspend(std::coroutine_handle<> h) { this->poller->AddWrite(this->fd, h); }
+        };
+        return TAwaitableWritable{poller_, fd_};
+    }
+
+    /**
+     * @brief Waits until the peer closes the connection (or shuts down its writing side).
+     */
     auto Monitor() {
         struct TAwaitableClose : public TAwaitable<TAwaitableClose> {
+            bool await_ready() { return (this->ready = false); }
             void run() { this->ret = true; }
             void await_suspend(std::coroutine_handle<> h) {
                 this->poller->AddRemoteHup(this->fd, h);
@@ -109,6 +309,14 @@ class TSocketBase : public TSocketBase<void> {
         return TAwaitableClose{poller_, fd_};
     }
 
+    /**
+     * @brief Monitor() that throws TTimeoutError if the connection is still open at @p deadline.
+     */
+    auto Monitor(TTime deadline) {
+        auto op = Monitor();
+        return TTimedAwaitable<decltype(op), TEvent::RHUP>{op, deadline};
+    }
+
     void Close() {
         if (fd_ >= 0) {
             TSockOps::close(fd_);
@@ -121,6 +329,7 @@ class TSocketBase : public TSocketBase<void> {
     TSocketBase(TPollerBase& poller, int domain, int type)
         : TSocketBase<void>(poller, domain, type) {}
     TSocketBase(int fd, TPollerBase& poller) : TSocketBase<void>(fd, poller) {}
+    TSocketBase(int fd, TPollerBase& poller, TNoSetup tag) : TSocketBase<void>(fd, poller, tag) {}
     TSocketBase() = default;
     TSocketBase(const TSocketBase&) = delete;
     TSocketBase& operator=(TSocketBase&) const = delete;
@@ -141,8 +350,13 @@ class TSocketBase : public TSocketBase<void> {
 
         void SafeRun() {
             ((T*)this)->run();
-            if (ret < 0 && !(errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
-                throw std::system_error(errno, std::generic_category(), "Socket operation failed");
+            if (ret < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    poller->Metrics().Again.Add();
+                } else if (errno != EINTR) {
+                    throw std::system_error(errno, std::generic_category(),
+                                            "Socket operation failed");
+                }
             }
         }
 
@@ -165,6 +379,20 @@ class TSockOps {
         return ::send(fd, static_cast<const char*>(buf), count, 0);
     }
 
+    static auto readv(int fd, const iovec* iov, size_t count) {
+        msghdr msg = {};
+        msg.msg_iov = const_cast<iovec*>(iov);
+        msg.msg_iovlen = std::min<size_t>(count, IOV_MAX);
+        return ::recvmsg(fd, &msg, 0);
+    }
+
+    static auto writev(int fd, const iovec* iov, size_t count) {
+        msghdr msg = {};
+        msg.msg_iov = const_cast<iovec*>(iov);
+        msg.msg_iovlen = std::min<size_t>(count, IOV_MAX);
+        return ::sendmsg(fd, &msg, 0);
+    }
+
     static auto close(int fd) {
         if (fd >= 0) {
             ::close(fd);
@@ -184,6 +412,13 @@ class TSocket : public TSocketBase<TSockOps> {
     TSocket(const TAddress& addr, int fd, TPoller& poller)
         : TSocketBase(fd, poller), remote_addr_(addr) {}
 
+    TSocket(int fd, TPoller& poller) : TSocketBase(fd, poller) {}
+
+    TSocket(const TAddress& addr, int fd, TPoller& poller, TNoSetup tag)
+        : TSocketBase(fd, poller, tag), remote_addr_(addr) {}
+
+    TSocket(int fd, TPoller& poller, TNoSetup tag) : TSocketBase(fd, poller, tag) {}
+
     TSocket(TSocket&& other) { *this = std::move(other); }
 
     TSocket& operator=(TSocket&& other) {
@@ -192,6 +427,7 @@ class TSocket : public TSocketBase<TSockOps> {
             poller_ = other.poller_;
             remote_addr_ = other.remote_addr_;
             local_addr_ = other.local_addr_;
+            zerocopy_ = std::move(other.zerocopy_);
             fd_ = other.fd_;
             other.fd_ = -1;
         }
@@ -199,16 +435,15 @@ class TSocket : public TSocketBase<TSockOps> {
     }
 
     auto Connect(const TAddress& addr, TTime deadline = TTime::max()) {
-        std::cout << "Connect to " << addr.ToString() << std::endl;
+        TN_TRACE(poller_->Trace(), Debug, ConnectBegin, fd_, addr.Domain());
         if (remote_addr_.has_value()) {
             throw std::runtime_error("Already connected");
         }
         remote_addr_ = addr;
         struct TAwaitable {
             bool await_ready() {
-                std::cout << "try to connect, fd: " << fd << std::endl;
                 int ret = connect(fd, addr.first, addr.second);
-                std::cout << "connect ret: " << ret << " , errno: " << errno << std::endl;
+                TN_TRACE(poller->Trace(), Debug, ConnectTry, fd, ret, ret < 0 ? errno : 0);
                 if (ret < 0 && !(errno == EINTR || errno == EAGAIN || errno == EINPROGRESS)) {
                     throw std::system_error(errno, std::generic_category(), "Connect failed");
                 }
@@ -216,18 +451,19 @@ class TSocket : public TSocketBase<TSockOps> {
             }
 
             void await_suspend(std::coroutine_handle<> h) {
-                std::cout << "suspend on Connecting, fd: " << fd << std::endl;
                 poller->AddWrite(fd, h);
                 if (deadline != TTime::max()) {
+                    handle = h;
                     time_id = poller->AddTimer(deadline, h);
-                    std::cout << "add timer, fd: " << fd << std::endl;
                 }
+                TN_TRACE(poller->Trace(), Debug, ConnectSuspend, fd, deadline != TTime::max());
             }
 
             void await_resume() {
-                std::cout << "resume on Connecting, fd: " << fd << std::endl;
-                if (deadline != TTime::max() && poller->RemoveTimer(time_id, deadline)) {
-                    throw std::runtime_error("Connect timeout");
+                TN_TRACE(poller->Trace(), Debug, ConnectResume, fd);
+                if (handle && poller->RemoveTimer(time_id)) {
+                    poller->RemoveWait(fd, TEvent::WRITE, handle);
+                    throw TTimeoutError("Connect timeout");
                 }
             }
 
@@ -235,52 +471,317 @@ class TSocket : public TSocketBase<TSockOps> {
             int fd;
             std::pair<const sockaddr*, int> addr;
             TTime deadline;
-            unsigned time_id = 0;
+            THandle handle = {};
+            TTimerId time_id = 0;
         };
 
         return TAwaitable{poller_, fd_, remote_addr_->RawAddr(), deadline};
     }
 
-    auto Accept() {
-        struct TAwaitable {
-            bool await_ready() { return false; }
-            void await_suspend(std::coroutine_handle<> h) {
-                std::cout << "suspend on Accepting, "
-                          << "fd: " << fd << std::endl;
-                poller->AddRead(fd, h);
-                std::cout << "suspend done" << std::endl;
-            }
-            TSocket await_resume() {
-                std::cout << "resume on Accepting, fd: " << fd << std::endl;
-                char clientaddr[sizeof(sockaddr_in6)];
-                socklen_t addrlen = sizeof(sockaddr_in6);
-
-                int clientfd = accept(fd, reinterpret_cast<sockaddr*>(clientaddr), &addrlen);
-                if (clientfd < 0) {
-                    throw std::system_error(errno, std::generic_category(), "Accept failed");
-                }
-                std::cout << "accept done" << std::endl;
-                return TSocket{TAddress{reinterpret_cast<sockaddr*>(clientaddr), addrlen}, clientfd,
-                               *poller};
+    /**
+     * @brief Accepts a connection, waiting for the listener to become readable if needed.
+     *
+     * Spurious wakeups are fine: several loops may be woken for one connection
+     * on a shared listener, the losers get EAGAIN and wait again. Throws TTimeoutError
+     * if no connection comes before @p deadline.
+     */
+    TValueTask<TSocket> Accept(TTime deadline = TTime::max()) {
+        TPollerBase* poller = poller_;
+        int fd = fd_;
+        while (true) {
+            char clientaddr[sizeof(sockaddr_in6)];
+            socklen_t addrlen = sizeof(sockaddr_in6);
+
+            int clientfd = TryAccept(fd, clientaddr, &addrlen);
+            if (clientfd >= 0) {
+                TN_TRACE(poller->Trace(), Debug, AcceptResume, fd, clientfd);
+                co_return TSocket{TAddress{reinterpret_cast<sockaddr*>(clientaddr), addrlen},
+                                  clientfd, *poller, TNoSetup{}};
             }
+            co_await TTimedAwaitable<TAwaitableAcceptWait, TEvent::READ>{{poller, fd}, deadline};
+        }
+    }
 
-            TPollerBase* poller;
-            int fd;
-        };
-        return TAwaitable{poller_, fd_};
+    /**
+     * @brief Accepts up to @p max pending connections per wakeup, each is passed to @p onAccept.
+     *
+     * Waits until at least one connection is accepted, then drains the backlog with
+     * accept4() until it is empty or @p max sockets were accepted, and returns their number.
+     * The sockets come non-blocking from the kernel, without the setup syscalls.
+     * Throws TTimeoutError if nothing is accepted before @p deadline.
+     *
+     * Example:
+     * @code
+     * while (true) {
+     *     co_await listener.AcceptBatch([](TSocket client) { Serve(std::move(client)); });
+     * }
+     * @endcode
+     */
+    template <typename TFunc>
+    TValueTask<size_t> AcceptBatch(TFunc onAccept, size_t max = 64,
+                                   TTime deadline = TTime::max()) {
+        return AcceptBatch<TSocket>(poller_, fd_, std::move(onAccept), max, deadline);
     }
 
     void Bind(const TAddress& addr);
 
     void Listen(int backlog = 128);
 
+    /**
+     * @brief Sends @p size bytes of the file @p fd from @p offset with sendfile().
+     *
+     * The data goes from the page cache to the socket without passing through user space.
+     * Waits for the socket to become writable whenever its buffer is full and returns the
+     * number of bytes sent, less than @p size only if the file ends earlier.
+     */
+    TValueTask<size_t> SendFile(int fd, off_t offset, size_t size) {
+        TPollerBase* poller = poller_;
+        int out = fd_;
+        size_t sent = 0;
+        while (sent < size) {
+            ssize_t ret = sendfile(out, fd, &offset, size - sent);
+            TN_TRACE(poller->Trace(), Debug, SendFile, out, fd, ret);
+            if (ret > 0) {
+                sent += ret;
+            } else if (ret == 0) {
+                break;  // end of file
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                co_await TAwaitableWriteWait{poller, out};
+            } else if (errno != EINTR) {
+                throw std::system_error(errno, std::generic_category(), "sendfile");
+            }
+        }
+        co_return sent;
+    }
+
+    /**
+     * @brief Enables SO_ZEROCOPY for WriteZeroCopy() calls of at least @p minSize bytes.
+     *
+     * @return false if the kernel or the socket type does not support it, WriteZeroCopy()
+     * then copies as WriteSome() does.
+     */
+    bool EnableZeroCopy(size_t minSize = 16 * 1024);
+
+    /**
+     * @brief Writes all of @p buf with MSG_ZEROCOPY, the pages are sent without a copy.
+     *
+     * The kernel keeps referencing @p buf after send() returns, so the coroutine is resumed
+     * only once the completions read from the error queue (MSG_ERRQUEUE) cover every send,
+     * after that the buffer may be reused or freed. Writes shorter than the minimal size, or
+     * after the kernel reported that it had to copy anyway (e.g. loopback), use plain send().
+     * Only one WriteZeroCopy() per socket may be in flight.
+     */
+    TValueTask<size_t> WriteZeroCopy(const void* buf, size_t size) {
+        TPollerBase* poller = poller_;
+        int fd = fd_;
+        TZeroCopyState* state = zerocopy_.get();
+        bool zerocopy = state && !state->Copied && size >= state->MinSize;
+        const char* p = static_cast<const char*>(buf);
+        size_t left = size;
+        while (left != 0) {
+            ssize_t ret = ::send(fd, p, left, MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0));
+            TN_TRACE(poller->Trace(), Debug, SocketWrite, fd, ret);
+            if (ret > 0) {
+                if (zerocopy) {
+                    ++state->Sent;
+                }
+                p += ret;
+                left -= ret;
+            } else if (ret == 0) {
+                throw std::runtime_error("Connection closed");
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                co_await TAwaitableWriteWait{poller, fd};
+            } else if (errno == ENOBUFS && zerocopy) {
+                // out of option memory for pending notifications: wait for some, or copy
+                if (state->Completed == state->Sent) {
+                    zerocopy = false;
+                } else if (!ReapZeroCopy(fd, state)) {
+                    co_await TAwaitableErrorWait{poller, fd};
+                }
+            } else if (errno != EINTR) {
+                throw std::system_error(errno, std::generic_category(), "send");
+            }
+        }
+        while (zerocopy && state->Completed != state->Sent) {
+            if (!ReapZeroCopy(fd, state)) {
+                co_await TAwaitableErrorWait{poller, fd};
+            }
+        }
+        co_return size;
+    }
+
+    /**
+     * @brief Sets SO_BUSY_POLL to @p timeout and, with @p prefer, SO_PREFER_BUSY_POLL.
+     *
+     * The kernel then polls the device queue of this socket in its reads for up to
+     * @p timeout instead of waiting for the interrupt; pairs with TPollerBase::SetBusyPoll().
+     * @return false if the kernel refuses it: raising SO_BUSY_POLL needs CAP_NET_ADMIN,
+     * SO_PREFER_BUSY_POLL needs Linux 5.11.
+     */
+    bool SetBusyPoll(std::chrono::microseconds timeout, bool prefer = false);
+
+    /**
+     * @brief Enables SO_REUSEPORT, must be called before Bind().
+     *
+     * Every socket bound to the same address gets its own accept queue,
+     * the kernel spreads incoming connections between them.
+     */
+    void SetReusePort(bool enable = true);
+
     const std::optional<TAddress>& RemoteAddr() const { return remote_addr_; }
 
     const std::optional<TAddress>& LocalAddr() const { return local_addr_; }
 
  protected:
+    struct TAwaitableAcceptWait {
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            TN_TRACE(poller->Trace(), Debug, AcceptSuspend, fd);
+            poller->AddRead(fd, h);
+        }
+        void await_resume() {}
+
+        TPollerBase* poller;
+        int fd;
+    };
+
+    struct TZeroCopyState {
+        size_t MinSize = 0;
+        uint32_t Sent = 0;       // MSG_ZEROCOPY sends, the kernel numbers them from 0
+        uint32_t Completed = 0;  // sends reported by the error queue
+        bool Copied = false;     // the kernel fell back to copying, zero-copy does not pay off
+    };
+
+    /**
+     * @brief Reads the pending MSG_ZEROCOPY completions of @p fd, false if there were none.
+     *
+     * Throws the socket error if the error queue was empty but the socket has one.
+     */
+    static bool ReapZeroCopy(int fd, TZeroCopyState* state);
+
+    struct TAwaitableErrorWait {
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> h) { poller->AddError(fd, h); }
+        void await_resume() {}
+
+        TPollerBase* poller;
+        int fd;
+    };
+
+    struct TAwaitableWriteWait {
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> h) { poller->AddWrite(fd, h); }
+        void await_resume() {}
+
+        TPollerBase* poller;
+        int fd;
+    };
+
+    /**
+     * @brief accept4() of a non-blocking socket, -1 if there is nothing to accept for now.
+     */
+    static int TryAccept(int fd, char* addr, socklen_t* len) {
+        int clientfd = accept4(fd, reinterpret_cast<sockaddr*>(addr), len,
+                               SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientfd < 0 &&
+            !(errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED)) {
+            throw std::system_error(errno, std::generic_category(), "Accept failed");
+        }
+        return clientfd;
+    }
+
+    template <typename TSock, typename TFunc>
+    static TValueTask<size_t> AcceptBatch(TPollerBase* poller, int fd, TFunc onAccept,
+                                          size_t max, TTime deadline) {
+        auto& owner = static_cast<typename TSock::TPoller&>(*poller);
+        while (true) {
+            size_t accepted = 0;
+            while (accepted < max) {
+                char clientaddr[sizeof(sockaddr_in6)];
+                socklen_t addrlen = sizeof(sockaddr_in6);
+                int clientfd = TryAccept(fd, clientaddr, &addrlen);
+                if (clientfd < 0) {
+                    if (errno == EINTR || errno == ECONNABORTED) {
+                        continue;
+                    }
+                    break;
+                }
+                TN_TRACE(poller->Trace(), Debug, AcceptResume, fd, clientfd);
+                ++accepted;
+                onAccept(TSock{TAddress{reinterpret_cast<sockaddr*>(clientaddr), addrlen},
+                               clientfd, owner, TNoSetup{}});
+            }
+            if (accepted > 0) {
+                co_return accepted;
+            }
+            co_await TTimedAwaitable<TAwaitableAcceptWait, TEvent::READ>{{poller, fd}, deadline};
+        }
+    }
+
     std::optional<TAddress> local_addr_;
     std::optional<TAddress> remote_addr_;
+    std::unique_ptr<TZeroCopyState> zerocopy_;  // stays in place when the socket is moved
+};
+
+class TFileOps {
+ public:
+    static auto read(int fd, void* buf, size_t count) { return ::read(fd, buf, count); }
+
+    static auto write(int fd, const void* buf, size_t count) { return ::write(fd, buf, count); }
+
+    static auto readv(int fd, const iovec* iov, size_t count) {
+        return ::readv(fd, iov, std::min<size_t>(count, IOV_MAX));
+    }
+
+    static auto writev(int fd, const iovec* iov, size_t count) {
+        return ::writev(fd, iov, std::min<size_t>(count, IOV_MAX));
+    }
+
+    static auto close(int fd) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+/**
+ * @class TFileHandle
+ * @brief A file, pipe or tty descriptor owned by a poller, with the socket read/write awaitables.
+ *
+ * Regular files are always ready, their reads and writes complete without waiting.
+ * A regular file is sent to a socket with TSocket::SendFile(file.Fd(), offset, size).
+ */
+class TFileHandle : public TSocketBase<TFileOps> {
+ public:
+    TFileHandle() = default;
+
+    TFileHandle(int fd, TPollerBase& poller) : TSocketBase(fd, poller) {}
+
+    /**
+     * @brief Opens @p path with open(2) @p flags.
+     */
+    TFileHandle(const char* path, TPollerBase& poller, int flags = O_RDONLY)
+        : TSocketBase(Open(path, flags), poller) {}
+
+    TFileHandle(TFileHandle&& other) { *this = std::move(other); }
+
+    TFileHandle& operator=(TFileHandle&& other) {
+        if (this != &other) {
+            Close();
+            poller_ = other.poller_;
+            fd_ = other.fd_;
+            other.fd_ = -1;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Size of the file from fstat().
+     */
+    off_t Size() const;
+
+ private:
+    static int Open(const char* path, int flags);
 };
 
 }  // namespace NNet
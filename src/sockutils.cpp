@@ -1,33 +1,41 @@
 #include <assert.h>
 #include <string.h>
+#include "scan.h"
 #include "sockutils.h"
 
 namespace NNet {
 
-TLineSplitter::TLineSplitter(int maxLen)
-    : WPos(0), RPos(0), Size(0), Cap(maxLen * 2), Data(Cap, 0), View(Data) {}
-
-TLine TLineSplitter::Pop() {
-    auto end = View.substr(RPos, Size);
-    auto begin = View.substr(0, Size - end.size());
-
-    auto p1 = end.find('\n');
-    if (p1 == std::string_view::npos) {
-        auto p2 = begin.find('\n');
-        if (p2 == std::string_view::npos) {
-            return {};
-        }
+void TNewlineQueue::Scan(std::string_view chunk, size_t offset) {
+    if (Head == Positions.size()) {
+        Positions.clear();
+        Head = 0;
+    }
+    ScanDelimiters(chunk.data(), chunk.size(), '\n', offset, Positions);
+}
 
-        RPos = p2 + 1;
-        Size -= end.size() + p2 + 1;
-        return TLine{end, begin.substr(0, p2 + 1)};
+TLine TNewlineQueue::Pop(std::string_view view, size_t cap, size_t& rpos, size_t& size) {
+    if (Head == Positions.size()) {
+        return {};
+    }
+    size_t pos = Positions[Head++];
+    size_t len = (pos + cap - rpos) % cap + 1;
+    TLine line;
+    if (rpos + len <= cap) {
+        line.Part1 = view.substr(rpos, len);
     } else {
-        RPos += p1 + 1;
-        Size -= p1 + 1;
-        return TLine{end.substr(0, p1 + 1), {}};
+        line.Part1 = view.substr(rpos);
+        line.Part2 = view.substr(0, len - line.Part1.size());
     }
+    rpos = (pos + 1) % cap;
+    size -= len;
+    return line;
 }
 
+TLineSplitter::TLineSplitter(int maxLen)
+    : WPos(0), RPos(0), Size(0), Cap(maxLen * 2), Data(Cap, 0), View(Data) {}
+
+TLine TLineSplitter::Pop() { return Newlines.Pop(View, Cap, RPos, Size); }
+
 void TLineSplitter::Push(const char* buf, size_t size) {
     if (Size + size > Data.size()) {
         throw std::runtime_error("Overflow");
@@ -36,52 +44,64 @@ void TLineSplitter::Push(const char* buf, size_t size) {
     auto first = std::min(size, Cap - WPos);
     memcpy(&Data[WPos], buf, first);
     memcpy(&Data[0], buf + first, std::max<size_t>(0, size - first));
+    Newlines.Scan(View.substr(WPos, first), WPos);
+    Newlines.Scan(View.substr(0, size - first), 0);
     WPos = (WPos + size) % Cap;
     Size = Size + size;
 }
 
-TZeroCopyLineSplitter::TZeroCopyLineSplitter(int maxLen)
-    : WPos(0), RPos(0), Size(0), Cap(maxLen * 2), Data(Cap, 0), View(Data) {}
-
-TLine TZeroCopyLineSplitter::Pop() {
-    auto end = View.substr(RPos, Size);
-    auto begin = View.substr(0, Size - end.size());
+TZeroCopyLineSplitter::TZeroCopyLineSplitter(int maxLen, TBufferPool* pool)
+    : WPos(0), RPos(0), Size(0), Cap(maxLen * 2), Pool(pool) {
+    if (!Pool) {
+        Data.resize(Cap);
+        View = Data;
+    }
+}
 
-    auto p1 = end.find('\n');
-    if (p1 == std::string_view::npos) {
-        auto p2 = begin.find('\n');
-        if (p2 == std::string_view::npos) {
-            return {};
-        }
+TLine TZeroCopyLineSplitter::Pop() { return Newlines.Pop(View, Cap, RPos, Size); }
 
-        RPos = p2 + 1;
-        Size -= end.size() + p2 + 1;
-        return TLine{end, begin.substr(0, p2 + 1)};
-    } else {
-        RPos += p1 + 1;
-        Size -= p1 + 1;
-        return TLine{end.substr(0, p1 + 1), {}};
+size_t TZeroCopyLineSplitter::PopAll(std::vector<TLine>& lines) {
+    size_t count = 0;
+    while (auto line = Pop()) {
+        lines.push_back(line);
+        ++count;
     }
+    return count;
 }
 
 std::span<char> TZeroCopyLineSplitter::Acquire(size_t size) {
+    if (Pool && !Buffer) {
+        Buffer = Pool->Acquire(Cap);
+        View = {Buffer.Data(), Cap};
+    }
     size = std::min(size, Cap - Size);
     if (size == 0) {
         throw std::runtime_error("Overflow");
     }
+    auto* data = const_cast<char*>(View.data());
     auto first = std::min(size, Cap - WPos);
     if (first) {
-        return {&Data[WPos], first};
+        return {data + WPos, first};
     } else {
-        return {&Data[0], size};
+        return {data, size};
     }
 }
 
 void TZeroCopyLineSplitter::Commit(size_t size) {
+    // Acquire() hands out a contiguous span, the committed bytes do not wrap
+    Newlines.Scan(View.substr(WPos, size), WPos);
     WPos = (WPos + size) % Cap;
     Size += size;
 }
 
+void TZeroCopyLineSplitter::ReleaseBuffer() {
+    if (Pool && Size == 0) {
+        Buffer.Release();
+        View = {};
+        WPos = RPos = 0;
+    }
+}
+
 void TZeroCopyLineSplitter::Push(const char* p, size_t len) {
     while (len != 0) {
         auto buf = Acquire(len);
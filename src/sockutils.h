@@ -1,4 +1,14 @@
 #pragma once
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <exception>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bufferpool.h"
 #include "corochain.h"
 #include "socket.h"
 
@@ -12,14 +22,31 @@ struct TLine {
     operator bool() const { return !Part1.empty(); }
 };
 
+/**
+ * @brief Drops the first @p size bytes from @p iov, fully consumed and empty entries are removed.
+ */
+inline void AdvanceIov(std::span<iovec>& iov, size_t size) {
+    while (!iov.empty() && size >= iov.front().iov_len) {
+        size -= iov.front().iov_len;
+        iov = iov.subspan(1);
+    }
+    if (size != 0) {
+        iov.front().iov_base = static_cast<char*>(iov.front().iov_base) + size;
+        iov.front().iov_len -= size;
+    }
+}
+
 template <typename TSocket>
 struct TByteReader {
     TByteReader(TSocket& socket) : Socket(socket) {}
 
-    TValueTask<void> Read(void* data, size_t size) {
+    /**
+     * @brief Reads exactly @p size bytes, throws TTimeoutError if they are late for @p deadline.
+     */
+    TValueTask<void> Read(void* data, size_t size, TTime deadline = TTime::max()) {
         char* p = static_cast<char*>(data);
         while (size != 0) {
-            auto readSize = co_await Socket.ReadSome(p, size);
+            auto readSize = co_await Socket.ReadSome(p, size, deadline);
             if (readSize == 0) {
                 throw std::runtime_error("Connection closed");
             }
@@ -32,6 +59,26 @@ struct TByteReader {
         co_return;
     }
 
+    /**
+     * @brief Fills all of @p parts, with one readv per wakeup.
+     */
+    TValueTask<void> Read(std::span<const iovec> parts, TTime deadline = TTime::max()) {
+        std::vector<iovec> buffers(parts.begin(), parts.end());
+        std::span<iovec> iov(buffers);
+        AdvanceIov(iov, 0);
+        while (!iov.empty()) {
+            auto readSize = co_await Socket.ReadSomeV(iov, deadline);
+            if (readSize == 0) {
+                throw std::runtime_error("Connection closed");
+            }
+            if (readSize < 0) {
+                continue;  // retry
+            }
+            AdvanceIov(iov, readSize);
+        }
+        co_return;
+    }
+
  private:
     TSocket& Socket;
 };
@@ -40,10 +87,10 @@ template <typename TSocket>
 struct TByteWriter {
     TByteWriter(TSocket& socket) : Socket(socket) {}
 
-    TValueTask<void> Write(const void* data, size_t size) {
+    TValueTask<void> Write(const void* data, size_t size, TTime deadline = TTime::max()) {
         const char* p = static_cast<const char*>(data);
         while (size != 0) {
-            auto readSize = co_await Socket.WriteSome(p, size);
+            auto readSize = co_await Socket.WriteSome(p, size, deadline);
             if (readSize == 0) {
                 throw std::runtime_error("Connection closed");
             }
@@ -56,26 +103,279 @@ struct TByteWriter {
         co_return;
     }
 
-    TValueTask<void> Write(const TLine& line) {
-        co_await Write(line.Part1.data(), line.Part1.size());
-        co_await Write(line.Part2.data(), line.Part2.size());
+    /**
+     * @brief Writes all of @p parts, e.g. a header and a body, with one writev per wakeup.
+     */
+    TValueTask<void> Write(std::span<const iovec> parts, TTime deadline = TTime::max()) {
+        std::vector<iovec> buffers(parts.begin(), parts.end());
+        co_await WriteAll(buffers, deadline);
+        co_return;
+    }
+
+    TValueTask<void> Write(const TLine& line, TTime deadline = TTime::max()) {
+        iovec buffers[2] = {{const_cast<char*>(line.Part1.data()), line.Part1.size()},
+                            {const_cast<char*>(line.Part2.data()), line.Part2.size()}};
+        co_await WriteAll(buffers, deadline);
         co_return;
     }
 
  private:
+    TValueTask<void> WriteAll(std::span<iovec> iov, TTime deadline) {
+        AdvanceIov(iov, 0);
+        while (!iov.empty()) {
+            auto writeSize = co_await Socket.WriteSomeV(iov, deadline);
+            if (writeSize == 0) {
+                throw std::runtime_error("Connection closed");
+            }
+            if (writeSize < 0) {
+                continue;  // retry
+            }
+            AdvanceIov(iov, writeSize);
+        }
+        co_return;
+    }
+
+    TSocket& Socket;
+};
+
+/**
+ * @brief Coalesces small writes: appends them to an output buffer sent once per loop step.
+ *
+ * The buffer is sent with one send() when TLoop ends the step or as soon as it holds
+ * @p flushSize bytes. What the socket does not take is sent in the background when it
+ * becomes writable. Write() waits for the buffer to drain when @p capacity would be
+ * exceeded, Flush() waits until everything is sent. Flush() before closing the socket:
+ * the data still buffered is dropped with the writer. Send errors of background flushes
+ * are rethrown by the next Write() or Flush().
+ *
+ * Example:
+ * @code
+ * TBufferedWriter<TSocket> writer(socket);
+ * for (auto& reply : replies) {
+ *     co_await writer.Write(reply.data(), reply.size());  // no syscall
+ * }
+ * @endcode
+ */
+template <typename TSocket>
+struct TBufferedWriter {
+    TBufferedWriter(TSocket& socket, size_t capacity = 65536, size_t flushSize = 16384)
+        : Socket(socket), Poller(socket.Poller()), Fd(socket.Fd()), Capacity(capacity),
+          FlushSize(std::min(flushSize, capacity)) {
+        Node.Flush = [](TDeferredFlush* node) { static_cast<TNode*>(node)->Owner->StepFlush(); };
+        Node.Owner = this;
+    }
+
+    TBufferedWriter(const TBufferedWriter&) = delete;
+    TBufferedWriter& operator=(const TBufferedWriter&) = delete;
+
+    ~TBufferedWriter() {
+        Poller->CancelFlush(&Node);
+        if (DrainHandle) {
+            if (Socket.Fd() == Fd) {
+                Poller->RemoveWait(Fd, TEvent::WRITE, DrainHandle);
+            } else {
+                Poller->RemoveEvent(DrainHandle);  // closed, the fd may belong to another socket
+            }
+            DrainHandle.destroy();
+        }
+    }
+
+    TValueTask<void> Write(const void* data, size_t size, TTime deadline = TTime::max()) {
+        Rethrow();
+        if (Pending() + size > Capacity) {
+            co_await Flush(deadline);
+        }
+        if (size >= Capacity) {
+            co_await TByteWriter<TSocket>(Socket).Write(data, size, deadline);
+            co_return;
+        }
+        auto* p = static_cast<const char*>(data);
+        Buffer.insert(Buffer.end(), p, p + size);
+        if (Draining) {
+            co_return;  // the background flush takes it
+        }
+        if (Pending() >= FlushSize) {
+            Poller->CancelFlush(&Node);
+            StepFlush();
+            Rethrow();
+        } else {
+            Poller->DeferFlush(&Node);
+        }
+        co_return;
+    }
+
+    TValueTask<void> Write(std::string_view data, TTime deadline = TTime::max()) {
+        co_await Write(data.data(), data.size(), deadline);
+        co_return;
+    }
+
+    /**
+     * @brief Sends the buffered bytes, throws TTimeoutError if the socket has not taken
+     * them by @p deadline. They stay buffered then.
+     */
+    TValueTask<void> Flush(TTime deadline = TTime::max()) {
+        Rethrow();
+        Poller->CancelFlush(&Node);
+        if (!Draining) {
+            StepFlush();
+        }
+        co_await TDrainWait{this, deadline};
+        Rethrow();
+        co_return;
+    }
+
+    /**
+     * @brief Bytes buffered and not sent yet.
+     */
+    size_t Pending() const { return Buffer.size() - Offset; }
+
+ private:
+    struct TNode : TDeferredFlush {
+        TBufferedWriter* Owner;
+    };
+
+    // the drain coroutine is only ever suspended here, the writer can destroy it
+    template <typename T>
+    struct TTrackedAwaitable : T {
+        void await_suspend(std::coroutine_handle<> h) {
+            T::await_suspend(h);
+            *Handle = h;
+        }
+
+        decltype(auto) await_resume() {
+            *Handle = {};
+            return T::await_resume();
+        }
+
+        THandle* Handle;
+    };
+
+    struct TDrainWait {
+        bool await_ready() { return !Writer->Draining; }
+
+        void await_suspend(std::coroutine_handle<> h) {
+            Writer->Waiter = h;
+            if (Deadline != TTime::max()) {
+                Writer->WaitTimer = Writer->Poller->AddTimer(Deadline, h);
+            }
+        }
+
+        void await_resume() {
+            if (Writer->Waiter) {
+                // not woken by the drain: the deadline
+                Writer->Waiter = {};
+                Writer->WaitTimer = 0;
+                throw TTimeoutError("Flush timeout");
+            }
+        }
+
+        TBufferedWriter* Writer;
+        TTime Deadline;
+    };
+
+    // one send of the pending bytes, the rest is left to the drain
+    void StepFlush() {
+        if (Pending() == 0 || Error) {
+            return;
+        }
+        try {
+            if (!Send()) {
+                Draining = true;
+                Drain();
+            }
+        } catch (...) {
+            Fail();
+        }
+    }
+
+    // true when everything is sent
+    bool Send() {
+        if (Socket.Fd() != Fd) {
+            throw std::runtime_error("Socket closed");  // the fd may belong to another socket
+        }
+        auto ret = ::send(Fd, Buffer.data() + Offset, Pending(), 0);
+        Poller->Metrics().CountWrite(ret);
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                Poller->Metrics().Again.Add();
+                return false;
+            }
+            throw std::system_error(errno, std::generic_category(), "Socket operation failed");
+        }
+        Offset += ret;
+        if (Offset == Buffer.size()) {
+            Buffer.clear();
+            Offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    TVoidTask Drain() {
+        try {
+            while (true) {
+                auto op = Socket.WaitWritable();
+                auto ready = co_await TTrackedAwaitable<decltype(op)>{op, &DrainHandle};
+                if (ready < 0) {
+                    continue;
+                }
+                if (Send()) {
+                    break;
+                }
+            }
+        } catch (...) {
+            Fail();
+        }
+        Draining = false;
+        if (Waiter) {
+            // resumed by the next Poll(), like a Yield()
+            if (WaitTimer) {
+                Poller->RemoveTimer(WaitTimer);
+            }
+            auto waiter = Waiter;
+            Waiter = {};
+            WaitTimer = 0;
+            Poller->AddTimer(TTime{}, waiter);
+        }
+    }
+
+    void Fail() {
+        Error = std::current_exception();
+        Buffer.clear();
+        Offset = 0;
+    }
+
+    void Rethrow() {
+        if (Error) {
+            std::rethrow_exception(std::exchange(Error, nullptr));
+        }
+    }
+
     TSocket& Socket;
+    TPollerBase* Poller;
+    int Fd;
+    size_t Capacity;
+    size_t FlushSize;
+    std::vector<char> Buffer;
+    size_t Offset = 0;  // sent bytes at the head of Buffer
+    TNode Node;
+    bool Draining = false;
+    THandle DrainHandle;   // the drain waiting for the socket to become writable
+    THandle Waiter;        // a Flush() waiting for the drain
+    TTimerId WaitTimer = 0;
+    std::exception_ptr Error;
 };
 
 template <typename T, typename TSocket>
 struct TStructReader {
     TStructReader(TSocket& socket) : Socket(socket) {}
 
-    TValueTask<T> Read() {
+    TValueTask<T> Read(TTime deadline = TTime::max()) {
         T res;
         size_t size = sizeof(T);
         char* p = reinterpret_cast<char*>(&res);
         while (size != 0) {
-            auto readSize = co_await Socket.ReadSome(p, size);
+            auto readSize = co_await Socket.ReadSome(p, size, deadline);
             if (readSize == 0) {
                 throw std::runtime_error("Connection closed");
             }
@@ -92,6 +392,21 @@ struct TStructReader {
     TSocket& Socket;
 };
 
+/**
+ * @brief Positions of the newlines of a ring buffer, found once per chunk when it arrives.
+ */
+struct TNewlineQueue {
+    void Scan(std::string_view chunk, size_t offset);
+
+    /**
+     * @brief Cuts the line ending at the next queued newline from the ring @p view.
+     */
+    TLine Pop(std::string_view view, size_t cap, size_t& rpos, size_t& size);
+
+    std::vector<size_t> Positions;
+    size_t Head = 0;
+};
+
 struct TLineSplitter {
  public:
     TLineSplitter(int maxLen);
@@ -106,52 +421,118 @@ struct TLineSplitter {
     size_t Cap;
     std::string Data;
     std::string_view View;
+    TNewlineQueue Newlines;
 };
 
+/**
+ * @brief Ring buffer of incoming bytes split into lines without copying.
+ *
+ * With a @p pool the storage is borrowed on the first Acquire() and can be given back
+ * with ReleaseBuffer() once all data is consumed, so an idle reader holds no memory.
+ */
 struct TZeroCopyLineSplitter {
  public:
-    TZeroCopyLineSplitter(int maxLen);
+    TZeroCopyLineSplitter(int maxLen, TBufferPool* pool = nullptr);
 
     TLine Pop();
+
+    /**
+     * @brief Appends every complete line to @p lines, returns their number.
+     */
+    size_t PopAll(std::vector<TLine>& lines);
+
     std::span<char> Acquire(size_t size);
     void Commit(size_t size);
     void Push(const char* p, size_t len);
 
+    bool Empty() const { return Size == 0; }
+
+    /**
+     * @brief Returns the storage to the pool if nothing is pending, invalidates popped lines.
+     */
+    void ReleaseBuffer();
+
  private:
     size_t WPos;
     size_t RPos;
     size_t Size;
     size_t Cap;
+    TBufferPool* Pool;
+    TPooledBuffer Buffer;
     std::string Data;
     std::string_view View;
+    TNewlineQueue Newlines;
 };
 
+/**
+ * @brief Reads lines from a socket, a line stays valid until the next Read().
+ *
+ * The buffer is borrowed from the loop-wide TBufferPool only while a partial line is
+ * pending, between lines the reader waits for readability without holding memory.
+ */
 template <typename TSocket>
 struct TLineReader {
     TLineReader(TSocket& socket, int maxLineSize = 4096)
-        : Socket(socket), Splitter(maxLineSize), ChunkSize(maxLineSize / 2) {}
+        : TLineReader(socket, maxLineSize, &socket.Poller()->BufferPool()) {}
+
+    TLineReader(TSocket& socket, int maxLineSize, TBufferPool* pool)
+        : Socket(socket), Splitter(maxLineSize, pool), ChunkSize(maxLineSize / 2) {}
 
-    TValueTask<TLine> Read() {
+    /**
+     * @brief The next line, throws TTimeoutError if it is not complete by @p deadline.
+     */
+    TValueTask<TLine> Read(TTime deadline = TTime::max()) {
         auto line = Splitter.Pop();
         while (!line) {
+            bool more = co_await Fill(deadline);
+            if (!more) {
+                break;
+            }
+            line = Splitter.Pop();
+        }
+        co_return line;
+    }
+
+    /**
+     * @brief Every complete line available after one read, empty at the end of the stream.
+     *
+     * The lines stay valid until the next Read() or ReadLines().
+     */
+    TValueTask<std::span<const TLine>> ReadLines(TTime deadline = TTime::max()) {
+        Lines.clear();
+        while (!Splitter.PopAll(Lines)) {
+            bool more = co_await Fill(deadline);
+            if (!more) {
+                break;
+            }
+        }
+        co_return std::span<const TLine>(Lines);
+    }
+
+ private:
+    // one read into the splitter, false at the end of the stream
+    TValueTask<bool> Fill(TTime deadline) {
+        while (true) {
+            // borrowing from the pool is cheap, the buffer goes back before a wait if empty
             auto buf = Splitter.Acquire(ChunkSize);
-            auto size = co_await Socket.ReadSome(buf.data(), buf.size());
+            auto size = Socket.TryReadSome(buf.data(), buf.size());
             if (size < 0) {
+                Splitter.ReleaseBuffer();
+                co_await Socket.WaitReadableYield(deadline);
                 continue;
             }
             if (size == 0) {
-                break;
+                co_return false;
             }
             Splitter.Commit(size);
-            line = Splitter.Pop();
+            co_return true;
         }
-        co_return line;
     }
 
- private:
     TSocket& Socket;
     TZeroCopyLineSplitter Splitter;
     int ChunkSize;
+    std::vector<TLine> Lines;
 };
 
 }  // namespace NNet
@@ -0,0 +1,101 @@
+#include <pthread.h>
+#include <string>
+#include "threadpool.h"
+
+namespace NNet {
+
+namespace {
+
+// the pool and the worker index of the current thread, if it is a pool worker
+thread_local TThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+TThreadPool::TThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(std::make_unique<TWorker>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_[i]->Thread = std::thread([this, i] { Work(i); });
+        auto name = "tinynet-pool-" + std::to_string(i);
+        pthread_setname_np(workers_[i]->Thread.native_handle(), name.substr(0, 15).c_str());
+    }
+}
+
+TThreadPool::~TThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker->Thread.join();
+    }
+}
+
+void TThreadPool::Submit(TThreadPoolTask* task) {
+    size_t index = current_pool == this ? current_worker
+                                        : next_.fetch_add(1, std::memory_order_relaxed) %
+                                              workers_.size();
+    {
+        auto& worker = *workers_[index];
+        std::lock_guard<std::mutex> lock(worker.Mutex);
+        worker.Tasks.push_back(task);
+    }
+    // counted once it can be taken, so a worker woken by the count finds the task. A worker
+    // going to sleep registers before it checks the count (both seq_cst): either it sees the
+    // task or this sees the sleeper, the lock then orders the notify after its wait began
+    pending_.fetch_add(1);
+    if (sleepers_.load() == 0) {
+        return;
+    }
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    sleep_cv_.notify_one();
+}
+
+TThreadPoolTask* TThreadPool::Take(size_t index) {
+    {
+        auto& own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        if (!own.Tasks.empty()) {
+            auto* task = own.Tasks.back();
+            own.Tasks.pop_back();
+            return task;
+        }
+    }
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        auto& victim = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.Mutex);
+        if (!victim.Tasks.empty()) {
+            auto* task = victim.Tasks.front();
+            victim.Tasks.pop_front();
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void TThreadPool::Work(size_t index) {
+    current_pool = this;
+    current_worker = index;
+    while (true) {
+        if (auto* task = Take(index)) {
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            task->Execute();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        if (stop_ && pending_.load(std::memory_order_relaxed) <= 0) {
+            return;
+        }
+        sleepers_.fetch_add(1);
+        sleep_cv_.wait(lock, [this] { return stop_ || pending_.load() > 0; });
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace NNet
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "poller.h"
+
+namespace NNet {
+
+/**
+ * @brief A unit of work for TThreadPool, owned by the submitter.
+ */
+struct TThreadPoolTask {
+    virtual ~TThreadPoolTask() = default;
+    virtual void Execute() noexcept = 0;
+};
+
+/**
+ * @class TThreadPool
+ * @brief Work-stealing pool for CPU-bound work that must not block a loop.
+ *
+ * Every worker has its own deque: it takes its newest task first and steals the
+ * oldest tasks of the others when it runs out. Tasks submitted from a worker go
+ * to its own deque, tasks from other threads are spread round-robin.
+ *
+ * Example:
+ * @code
+ * auto digest = co_await pool.Run(loop.Poller(), [&] { return Sha256(payload); });
+ * @endcode
+ */
+class TThreadPool {
+ public:
+    explicit TThreadPool(size_t threads = std::thread::hardware_concurrency());
+
+    /**
+     * @brief Runs the tasks left in the queues and joins the workers.
+     */
+    ~TThreadPool();
+
+    TThreadPool(const TThreadPool&) = delete;
+    TThreadPool& operator=(const TThreadPool&) = delete;
+
+    size_t Size() const { return workers_.size(); }
+
+    /**
+     * @brief Queues @p task, it must stay alive until Execute() is called.
+     */
+    void Submit(TThreadPoolTask* task);
+
+    /**
+     * @brief Runs @p func on a worker, the awaiting coroutine is resumed on @p poller.
+     *
+     * The result of @p func is returned by co_await, an exception thrown by @p func
+     * is rethrown in the coroutine.
+     */
+    template <typename TFunc>
+    auto Run(TPollerBase& poller, TFunc func) {
+        using TResult = std::invoke_result_t<TFunc&>;
+        using TStorage =
+            std::conditional_t<std::is_void_v<TResult>, std::monostate, std::optional<TResult>>;
+
+        struct TAwaitable : TThreadPoolTask {
+            TAwaitable(TThreadPool* pool, TPollerBase* poller, TFunc&& func)
+                : pool(pool), poller(poller), func(std::move(func)) {}
+
+            bool await_ready() { return false; }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                node.Handle = h;
+                pool->Submit(this);
+            }
+
+            TResult await_resume() {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                if constexpr (!std::is_void_v<TResult>) {
+                    return std::move(*result);
+                }
+            }
+
+            void Execute() noexcept override {
+                try {
+                    if constexpr (std::is_void_v<TResult>) {
+                        func();
+                    } else {
+                        result.emplace(func());
+                    }
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                // the last access: the frame holding this awaitable may be gone once it is resumed
+                poller->PushRemote(&node);
+            }
+
+            TThreadPool* pool;
+            TPollerBase* poller;
+            TFunc func;
+            TStorage result;
+            std::exception_ptr error;
+            TRemoteNode node;
+        };
+
+        return TAwaitable{this, &poller, std::move(func)};
+    }
+
+ private:
+    struct alignas(64) TWorker {
+        std::mutex Mutex;
+        std::deque<TThreadPoolTask*> Tasks;
+        std::thread Thread;
+    };
+
+    void Work(size_t index);
+    TThreadPoolTask* Take(size_t index);
+
+    std::vector<std::unique_ptr<TWorker>> workers_;
+    std::atomic<size_t> next_ = 0;      // round-robin target for external submits
+    std::atomic<int64_t> pending_ = 0;  // queued and not yet taken tasks, counted after the
+                                        // push: below 0 while taken ones are not counted yet
+    std::atomic<size_t> sleepers_ = 0;  // workers waiting on sleep_cv_
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    bool stop_ = false;
+};
+
+}  // namespace NNet
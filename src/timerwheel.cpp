@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include "timerwheel.h"
+
+namespace NNet {
+
+TTimerWheel::TTimerWheel(std::chrono::nanoseconds tick, TTime start) : tick_(tick), start_(start) {
+    if (tick_.count() <= 0) {
+        throw std::invalid_argument("timer wheel tick must be positive");
+    }
+    nodes_.emplace_back();
+}
+
+void TTimerWheel::SetTick(std::chrono::nanoseconds tick) {
+    if (tick.count() <= 0) {
+        throw std::invalid_argument("timer wheel tick must be positive");
+    }
+    if (!Empty()) {
+        throw std::logic_error("cannot change the tick of a timer wheel with pending timers");
+    }
+    tick_ = tick;
+    start_ = TClock::now();
+    current_ = 0;
+}
+
+TTimerId TTimerWheel::Add(TTime deadline, THandle handle) {
+    uint32_t index;
+    if (!free_.empty()) {
+        index = free_.back();
+        free_.pop_back();
+    } else {
+        if (nodes_.size() > std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("too many timers");
+        }
+        index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    auto& node = nodes_[index];
+    node.Deadline = deadline;
+    node.Handle = handle;
+    Link(index, ListFor(TickOf(deadline)));
+    ++size_;
+    return (static_cast<TTimerId>(node.Gen) << 32) | index;
+}
+
+bool TTimerWheel::Remove(TTimerId id) {
+    uint32_t index = static_cast<uint32_t>(id);
+    uint32_t gen = static_cast<uint32_t>(id >> 32);
+    if (index == kNone || index >= nodes_.size()) {
+        return false;
+    }
+    auto& node = nodes_[index];
+    if (node.Gen != gen || node.List == kLists) {
+        return false;
+    }
+    Unlink(index);
+    Free(index);
+    return true;
+}
+
+void TTimerWheel::Advance(TTime now) {
+    uint64_t target = TickOf(now);
+    while (current_ < target) {
+        MoveAll(current_ & (kSlots - 1), kExpiredList);
+        // empty slots are skipped, a long sleep costs one step per non-empty slot
+        current_ = std::min(NextEventTick(), target);
+        if ((current_ & (kSlots - 1)) == 0) {
+            Cascade();
+        }
+    }
+    ExpireCurrent(now);
+}
+
+bool TTimerWheel::PopExpired(TTimerId* id, THandle* handle) {
+    uint32_t index = heads_[kExpiredList];
+    if (index == kNone) {
+        return false;
+    }
+    auto& node = nodes_[index];
+    *id = (static_cast<TTimerId>(node.Gen) << 32) | index;
+    *handle = node.Handle;
+    Unlink(index);
+    Free(index);
+    return true;
+}
+
+TTime TTimerWheel::NextDeadline() const {
+    if (size_ == 0) {
+        return TTime::max();
+    }
+    if (heads_[kExpiredList] != kNone) {
+        return TTime{};
+    }
+    uint32_t current = current_ & (kSlots - 1);
+    if (heads_[current] != kNone) {
+        return slot_min_[current];
+    }
+    // slots of lower levels always precede the slots of higher levels
+    for (int level = 0; level < kLevels; ++level) {
+        uint32_t index = (current_ >> (kLevelBits * level)) & (kSlots - 1);
+        int next = NextSlot(level, index);
+        if (next >= 0) {
+            return slot_min_[level * kSlots + next];
+        }
+    }
+    return slot_min_[kOverflowList];
+}
+
+uint64_t TTimerWheel::TickOf(TTime t) const {
+    if (t <= start_) {
+        return 0;
+    }
+    return static_cast<uint64_t>((t - start_) / tick_);
+}
+
+uint32_t TTimerWheel::ListFor(uint64_t tick) const {
+    if (tick <= current_) {
+        return current_ & (kSlots - 1);
+    }
+    for (int level = 0; level < kLevels; ++level) {
+        int shift = kLevelBits * (level + 1);
+        if ((tick >> shift) == (current_ >> shift)) {
+            return level * kSlots + ((tick >> (kLevelBits * level)) & (kSlots - 1));
+        }
+    }
+    return kOverflowList;
+}
+
+void TTimerWheel::Link(uint32_t index, uint32_t list) {
+    auto& node = nodes_[index];
+    node.List = list;
+    node.Next = kNone;
+    node.Prev = tails_[list];
+    if (node.Prev != kNone) {
+        nodes_[node.Prev].Next = index;
+        slot_min_[list] = std::min(slot_min_[list], node.Deadline);
+    } else {
+        heads_[list] = index;
+        slot_min_[list] = node.Deadline;
+        if (list < kOverflowList) {
+            bits_[list / kSlots][(list % kSlots) / 64] |= 1ull << (list % 64);
+        }
+    }
+    tails_[list] = index;
+}
+
+void TTimerWheel::Unlink(uint32_t index) {
+    auto& node = nodes_[index];
+    uint32_t list = node.List;
+    if (node.Prev != kNone) {
+        nodes_[node.Prev].Next = node.Next;
+    } else {
+        heads_[list] = node.Next;
+    }
+    if (node.Next != kNone) {
+        nodes_[node.Next].Prev = node.Prev;
+    } else {
+        tails_[list] = node.Prev;
+    }
+    if (heads_[list] == kNone && list < kOverflowList) {
+        bits_[list / kSlots][(list % kSlots) / 64] &= ~(1ull << (list % 64));
+    }
+    node.Prev = node.Next = kNone;
+}
+
+void TTimerWheel::Free(uint32_t index) {
+    auto& node = nodes_[index];
+    node.List = kLists;
+    node.Handle = {};
+    if (++node.Gen == 0) {
+        node.Gen = 1;
+    }
+    free_.push_back(index);
+    --size_;
+}
+
+void TTimerWheel::MoveAll(uint32_t from, uint32_t to) {
+    while (heads_[from] != kNone) {
+        uint32_t index = heads_[from];
+        Unlink(index);
+        Link(index, to);
+    }
+}
+
+void TTimerWheel::Redistribute(uint32_t list) {
+    // detach first: overflow timers may go back to the overflow list
+    uint32_t index = heads_[list];
+    heads_[list] = tails_[list] = kNone;
+    if (list < kOverflowList) {
+        bits_[list / kSlots][(list % kSlots) / 64] &= ~(1ull << (list % 64));
+    }
+    while (index != kNone) {
+        uint32_t next = nodes_[index].Next;
+        Link(index, ListFor(TickOf(nodes_[index].Deadline)));
+        index = next;
+    }
+}
+
+void TTimerWheel::Cascade() {
+    if ((current_ & 0xffffffffull) == 0) {
+        Redistribute(kOverflowList);
+    }
+    for (int level = kLevels - 1; level >= 1; --level) {
+        uint64_t mask = (1ull << (kLevelBits * level)) - 1;
+        if ((current_ & mask) == 0) {
+            Redistribute(level * kSlots + ((current_ >> (kLevelBits * level)) & (kSlots - 1)));
+        }
+    }
+}
+
+void TTimerWheel::ExpireCurrent(TTime now) {
+    uint32_t list = current_ & (kSlots - 1);
+    if (heads_[list] == kNone || now < slot_min_[list]) {
+        return;
+    }
+    TTime rest = TTime::max();
+    for (uint32_t index = heads_[list]; index != kNone;) {
+        uint32_t next = nodes_[index].Next;
+        if (nodes_[index].Deadline <= now) {
+            Unlink(index);
+            Link(index, kExpiredList);
+        } else {
+            rest = std::min(rest, nodes_[index].Deadline);
+        }
+        index = next;
+    }
+    slot_min_[list] = rest;
+}
+
+uint64_t TTimerWheel::NextEventTick() const {
+    for (int level = 0; level < kLevels; ++level) {
+        int shift = kLevelBits * level;
+        int next = NextSlot(level, (current_ >> shift) & (kSlots - 1));
+        if (next >= 0) {
+            uint64_t window = (current_ >> (shift + kLevelBits)) << (shift + kLevelBits);
+            return window + (static_cast<uint64_t>(next) << shift);
+        }
+    }
+    if (heads_[kOverflowList] != kNone) {
+        return ((current_ >> 32) + 1) << 32;
+    }
+    return std::numeric_limits<uint64_t>::max();
+}
+
+int TTimerWheel::NextSlot(int level, uint32_t after) const {
+    for (uint32_t i = after + 1; i < kSlots;) {
+        uint64_t word = bits_[level][i / 64] >> (i % 64);
+        if (word) {
+            return static_cast<int>(i + std::countr_zero(word));
+        }
+        i = (i / 64 + 1) * 64;
+    }
+    return -1;
+}
+
+}  // namespace NNet
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "base.h"
+
+namespace NNet {
+
+/**
+ * @class TTimerWheel
+ * @brief Hierarchical hashed timer wheel with O(1) insert and cancel.
+ *
+ * Four levels of 256 slots cover 2^32 ticks, timers beyond that wait in an
+ * overflow list. A timer is linked into the slot of its level, lower levels are
+ * refilled (cascaded) from the next level whenever the wheel enters a new window.
+ * Advancing skips empty slots, so a long idle period costs nothing.
+ *
+ * Deadlines are kept exactly: a timer never fires before its deadline, and the
+ * slot of the current tick is checked against the precise time, so the tick
+ * only bounds the work per advance, not the timer precision.
+ */
+class TTimerWheel {
+ public:
+    explicit TTimerWheel(std::chrono::nanoseconds tick = std::chrono::milliseconds(1),
+                         TTime start = TClock::now());
+
+    TTimerWheel(const TTimerWheel&) = delete;
+    TTimerWheel& operator=(const TTimerWheel&) = delete;
+
+    /**
+     * @brief Changes the tick resolution, allowed only while the wheel is empty.
+     */
+    void SetTick(std::chrono::nanoseconds tick);
+
+    std::chrono::nanoseconds Tick() const { return tick_; }
+
+    TTimerId Add(TTime deadline, THandle handle);
+
+    /**
+     * @brief Unlinks a pending timer.
+     *
+     * @return false if @p id already fired or was removed before.
+     */
+    bool Remove(TTimerId id);
+
+    /**
+     * @brief Moves every timer with deadline <= @p now to the expired list.
+     */
+    void Advance(TTime now);
+
+    /**
+     * @brief Pops one timer from the expired list filled by Advance().
+     */
+    bool PopExpired(TTimerId* id, THandle* handle);
+
+    /**
+     * @brief A lower bound of the earliest deadline, TTime::max() if there are no timers.
+     *
+     * Exact for timers due within the current level 0 window.
+     */
+    TTime NextDeadline() const;
+
+    size_t Size() const { return size_; }
+
+    bool Empty() const { return size_ == 0; }
+
+ private:
+    static constexpr int kLevelBits = 8;
+    static constexpr uint32_t kSlots = 1u << kLevelBits;
+    static constexpr int kLevels = 4;
+    static constexpr uint32_t kOverflowList = kLevels * kSlots;
+    static constexpr uint32_t kExpiredList = kOverflowList + 1;
+    static constexpr uint32_t kLists = kExpiredList + 1;
+    static constexpr uint32_t kNone = 0;
+
+    struct TNode {
+        TTime Deadline;
+        THandle Handle;
+        uint32_t Prev = kNone;
+        uint32_t Next = kNone;
+        uint32_t Gen = 1;
+        uint32_t List = kLists;  // kLists if the node is free
+    };
+
+    uint64_t TickOf(TTime t) const;
+    uint32_t ListFor(uint64_t tick) const;
+    void Link(uint32_t index, uint32_t list);
+    void Unlink(uint32_t index);
+    void Free(uint32_t index);
+    void MoveAll(uint32_t from, uint32_t to);
+    void Redistribute(uint32_t list);
+    void Cascade();
+    void ExpireCurrent(TTime now);
+    uint64_t NextEventTick() const;
+    int NextSlot(int level, uint32_t after) const;
+
+    std::chrono::nanoseconds tick_;
+    TTime start_;
+    uint64_t current_ = 0;  // all slots before this tick are processed
+    size_t size_ = 0;
+
+    std::vector<TNode> nodes_;  // nodes_[0] is unused, index 0 means "no node"
+    std::vector<uint32_t> free_;
+    uint32_t heads_[kLists] = {};
+    uint32_t tails_[kLists] = {};
+    TTime slot_min_[kLists] = {};               // lower bound of the deadlines in a list
+    uint64_t bits_[kLevels][kSlots / 64] = {};  // non-empty slots of each level
+};
+
+}  // namespace NNet
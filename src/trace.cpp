@@ -0,0 +1,125 @@
+#include <string.h>
+#include <stdexcept>
+#include "trace.h"
+
+namespace NNet {
+
+namespace {
+
+constexpr char trace_magic[8] = {'T', 'N', 'T', 'R', 'A', 'C', 'E', '1'};
+
+const TTraceEventInfo trace_events[] = {
+    {"TimerAdd", {"id", "deadline_ns", nullptr}},
+    {"TimerFire", {"id", nullptr, nullptr}},
+    {"SleepSuspend", {"timer_id", "deadline_ns", nullptr}},
+    {"AddRead", {"fd", "max_fd", "changes"}},
+    {"PollBegin", {"changes", "max_fd", "timeout_ns"}},
+    {"PollChange", {"fd", "type", "has_handle"}},
+    {"EpollCtl", {"fd", "op", "events"}},
+    {"PollWait", {"nfds", "ready", nullptr}},
+    {"PollEvent", {"fd", "events", nullptr}},
+    {"SocketRead", {"fd", "ret", nullptr}},
+    {"SocketReadYield", {"fd", "ret", nullptr}},
+    {"SocketWrite", {"fd", "ret", nullptr}},
+    {"SocketWriteYield", {"fd", "ret", nullptr}},
+    {"ConnectBegin", {"fd", "domain", nullptr}},
+    {"ConnectTry", {"fd", "ret", "errno"}},
+    {"ConnectSuspend", {"fd", "has_deadline", nullptr}},
+    {"ConnectResume", {"fd", nullptr, nullptr}},
+    {"AcceptSuspend", {"fd", nullptr, nullptr}},
+    {"AcceptResume", {"fd", "client_fd", nullptr}},
+    {"UringSubmit", {"submitted", nullptr, nullptr}},
+    {"UringComplete", {"user_data", "res", "flags"}},
+    {"SendFile", {"fd", "file_fd", "ret"}},
+};
+
+static_assert(sizeof(trace_events) / sizeof(trace_events[0]) ==
+              static_cast<size_t>(ETraceEvent::Count));
+
+}  // namespace
+
+const TTraceEventInfo& GetTraceEventInfo(ETraceEvent event) {
+    static const TTraceEventInfo unknown = {"Unknown", {"arg0", "arg1", "arg2"}};
+    auto index = static_cast<size_t>(event);
+    return index < static_cast<size_t>(ETraceEvent::Count) ? trace_events[index] : unknown;
+}
+
+const char* GetTraceLevelName(ETraceLevel level) {
+    switch (level) {
+        case ETraceLevel::Debug:
+            return "DEBUG";
+        case ETraceLevel::Info:
+            return "INFO";
+        case ETraceLevel::Warn:
+            return "WARN";
+        case ETraceLevel::Error:
+            return "ERROR";
+        default:
+            return "?";
+    }
+}
+
+void TTraceRing::Reset(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    if (capacity == 0) {
+        records_.reset();
+        mask_ = 0;
+    } else {
+        records_.reset(new TTraceRecord[size]);
+        mask_ = size - 1;
+    }
+    head_.store(0, std::memory_order_release);
+}
+
+std::vector<TTraceRecord> TTraceRing::Snapshot() const {
+    std::vector<TTraceRecord> ret;
+    if (!records_) {
+        return ret;
+    }
+    uint64_t capacity = mask_ + 1;
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t begin = head > capacity ? head - capacity : 0;
+    ret.reserve(head - begin);
+    for (uint64_t i = begin; i < head; ++i) {
+        ret.push_back(records_[i & mask_]);
+    }
+    // the writer may have lapped the records copied first, and it may be writing record
+    // `after` into the slot of record after - capacity right now
+    uint64_t after = head_.load(std::memory_order_acquire);
+    uint64_t overwritten = after + 1 > capacity ? after + 1 - capacity : 0;
+    if (overwritten > begin) {
+        ret.erase(ret.begin(), ret.begin() + std::min<uint64_t>(overwritten - begin, ret.size()));
+    }
+    return ret;
+}
+
+void TTraceRing::Dump(std::ostream& out) const {
+    auto records = Snapshot();
+    uint32_t header[2] = {static_cast<uint32_t>(sizeof(TTraceRecord)),
+                          static_cast<uint32_t>(records.size())};
+    out.write(trace_magic, sizeof(trace_magic));
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TTraceRecord));
+}
+
+std::vector<TTraceRecord> TTraceRing::Load(std::istream& in) {
+    char magic[sizeof(trace_magic)];
+    uint32_t header[2];
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, trace_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Bad trace magic");
+    }
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        header[0] != sizeof(TTraceRecord)) {
+        throw std::runtime_error("Unsupported trace record size");
+    }
+    std::vector<TTraceRecord> records(header[1]);
+    if (!in.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(TTraceRecord))) {
+        throw std::runtime_error("Truncated trace");
+    }
+    return records;
+}
+
+}  // namespace NNet
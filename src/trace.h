@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "base.h"
+
+/**
+ * Trace levels below TINYNET_TRACE_LEVEL are compiled out:
+ * 0 - debug, 1 - info, 2 - warn, 3 - error, 4 - off.
+ */
+#ifndef TINYNET_TRACE_LEVEL
+#define TINYNET_TRACE_LEVEL 1
+#endif
+
+/**
+ * @brief Appends a record to a trace ring if @p level is compiled in.
+ *
+ * The arguments are not evaluated when the level is filtered out.
+ * Example: TN_TRACE(poller->Trace(), Debug, SocketRead, fd, ret);
+ */
+#define TN_TRACE(ring, level, event, ...)                                                \
+    do {                                                                                 \
+        if constexpr (::NNet::TraceEnabled(::NNet::ETraceLevel::level)) {                \
+            (ring).Write(::NNet::ETraceLevel::level, ::NNet::ETraceEvent::event,         \
+                         ##__VA_ARGS__);                                                 \
+        }                                                                                \
+    } while (0)
+
+namespace NNet {
+
+enum class ETraceLevel : uint8_t { Debug = 0, Info = 1, Warn = 2, Error = 3, Off = 4 };
+
+constexpr ETraceLevel CompiledTraceLevel = static_cast<ETraceLevel>(TINYNET_TRACE_LEVEL);
+
+constexpr bool TraceEnabled(ETraceLevel level) {
+    return level != ETraceLevel::Off && level >= CompiledTraceLevel;
+}
+
+enum class ETraceEvent : uint16_t {
+    TimerAdd,        // id, deadline (ns)
+    TimerFire,       // id
+    SleepSuspend,    // timer id, deadline (ns)
+    AddRead,         // fd, max fd, changes size
+    PollBegin,       // changes size, max fd, timeout (ns)
+    PollChange,      // fd, event type, has handle
+    EpollCtl,        // fd, EPOLL_CTL_* op, events
+    PollWait,        // ready descriptors, ready events
+    PollEvent,       // fd, events
+    SocketRead,      // fd, ret
+    SocketReadYield,
+    SocketWrite,
+    SocketWriteYield,
+    ConnectBegin,    // fd, domain
+    ConnectTry,      // fd, ret, errno
+    ConnectSuspend,  // fd, has deadline
+    ConnectResume,   // fd
+    AcceptSuspend,   // fd
+    AcceptResume,    // fd, client fd
+    UringSubmit,     // submitted
+    UringComplete,   // user data, res, flags
+    SendFile,        // fd, file fd, ret
+    Count
+};
+
+struct TTraceEventInfo {
+    const char* Name;
+    const char* Args[3];
+};
+
+/**
+ * @brief Name and argument names of @p event, used by the offline dumper.
+ */
+const TTraceEventInfo& GetTraceEventInfo(ETraceEvent event);
+
+const char* GetTraceLevelName(ETraceLevel level);
+
+struct TTraceRecord {
+    uint64_t Time;  // steady clock, ns
+    uint16_t Event;
+    uint8_t Level;
+    uint8_t Reserved[5];
+    int64_t Args[3];
+};
+
+/**
+ * @brief Fixed size binary ring of trace records, one per loop.
+ *
+ * The loop thread is the only writer and never blocks, the oldest records are
+ * overwritten. Snapshot() may be called from any thread: records which were
+ * overwritten while copying are dropped from the result.
+ */
+class TTraceRing {
+ public:
+    explicit TTraceRing(size_t capacity = TraceEnabled(ETraceLevel::Error) ? 4096 : 0) {
+        Reset(capacity);
+    }
+
+    TTraceRing(const TTraceRing&) = delete;
+    TTraceRing& operator=(const TTraceRing&) = delete;
+
+    /**
+     * @brief Drops all records and changes the capacity (rounded up to a power of 2).
+     */
+    void Reset(size_t capacity);
+
+    template <typename... TArgs>
+    void Write(ETraceLevel level, ETraceEvent event, TArgs... args) {
+        static_assert(sizeof...(TArgs) <= 3, "Too many trace arguments");
+        if (!records_) {
+            return;
+        }
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        auto& rec = records_[head & mask_];
+        rec.Time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       TClock::now().time_since_epoch())
+                       .count();
+        rec.Event = static_cast<uint16_t>(event);
+        rec.Level = static_cast<uint8_t>(level);
+        int64_t values[3] = {static_cast<int64_t>(args)...};
+        rec.Args[0] = values[0];
+        rec.Args[1] = values[1];
+        rec.Args[2] = values[2];
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    size_t Capacity() const { return records_ ? mask_ + 1 : 0; }
+
+    uint64_t Written() const { return head_.load(std::memory_order_acquire); }
+
+    std::vector<TTraceRecord> Snapshot() const;
+
+    /**
+     * @brief Writes a snapshot in the binary format read by tools/tracedump.
+     */
+    void Dump(std::ostream& out) const;
+
+    static std::vector<TTraceRecord> Load(std::istream& in);
+
+ private:
+    std::unique_ptr<TTraceRecord[]> records_;
+    uint64_t mask_ = 0;
+    std::atomic<uint64_t> head_ = 0;
+};
+
+}  // namespace NNet
@@ -0,0 +1,589 @@
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "uring.h"
+
+namespace NNet {
+
+namespace {
+
+int uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg,
+                size_t argsz) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+int uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template <typename T>
+T load_acquire(T& v) {
+    return std::atomic_ref<T>(v).load(std::memory_order_acquire);
+}
+
+template <typename T>
+void store_release(T& v, T value) {
+    std::atomic_ref<T>(v).store(value, std::memory_order_release);
+}
+
+constexpr uint64_t ignored_user_data = 0;
+constexpr uint64_t wake_user_data = 1;  // operation ids always have a non zero generation
+
+}  // namespace
+
+TUring::TUring(unsigned queueSize) : ops_(1), fd_ops_(1024) {
+    io_uring_params params = {};
+    fd_ = uring_setup(queueSize, &params);
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+    }
+    ext_arg_ = params.features & IORING_FEAT_EXT_ARG;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+    auto map = [&](size_t size, off_t offset) {
+        void* p =
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        if (p == MAP_FAILED) {
+            int err = errno;
+            Release();
+            throw std::system_error(err, std::generic_category(), "io_uring mmap");
+        }
+        return p;
+    };
+
+    sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+TUring::~TUring() { Release(); }
+
+void TUring::Release() {
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    cq_ring_ = nullptr;
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+void TUring::Reserve(unsigned count) {
+    if (sq_local_tail_ - load_acquire(*sq_head_) + count > sq_entries_) {
+        Submit();
+        if (sq_local_tail_ - load_acquire(*sq_head_) + count > sq_entries_) {
+            throw std::runtime_error("io_uring submission queue overflow");
+        }
+    }
+}
+
+io_uring_sqe* TUring::GetSqe() {
+    Reserve(1);
+    unsigned index = sq_local_tail_ & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sq_local_tail_;
+    ++to_submit_;
+    return sqe;
+}
+
+void TUring::Submit() {
+    store_release(*sq_tail_, sq_local_tail_);
+    while (to_submit_ > 0) {
+        int ret = uring_enter(fd_, to_submit_, 0, 0, nullptr, 0);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EBUSY) {
+                break;  // the completion queue is full, the next Poll reaps it
+            }
+            throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+        }
+        metrics_.UringSubmitted.Add(ret);
+        to_submit_ -= std::min<unsigned>(ret, to_submit_);
+    }
+    if (to_submit_ == 0) {
+        link_timeouts_.clear();
+    }
+}
+
+uint32_t TUring::AllocOp(int fd) {
+    uint32_t id;
+    if (free_ops_.empty()) {
+        id = static_cast<uint32_t>(ops_.size());
+        ops_.emplace_back();
+    } else {
+        id = free_ops_.back();
+        free_ops_.pop_back();
+    }
+    if (static_cast<int>(fd_ops_.size()) <= fd) {
+        fd_ops_.resize(fd + 1);
+    }
+    auto& op = ops_[id];
+    op.Fd = fd;
+    op.Prev = 0;
+    op.Next = fd_ops_[fd];
+    if (op.Next) {
+        ops_[op.Next].Prev = id;
+    }
+    fd_ops_[fd] = id;
+    return id;
+}
+
+void TUring::Unlink(uint32_t id) {
+    auto& op = ops_[id];
+    if (op.Fd < 0) {
+        return;
+    }
+    if (op.Prev) {
+        ops_[op.Prev].Next = op.Next;
+    } else {
+        fd_ops_[op.Fd] = op.Next;
+    }
+    if (op.Next) {
+        ops_[op.Next].Prev = op.Prev;
+    }
+    op.Fd = -1;
+    op.Prev = op.Next = 0;
+}
+
+void TUring::FreeOp(uint32_t id) {
+    Unlink(id);
+    auto& op = ops_[id];
+    op.Handle = {};
+    op.Result = nullptr;
+    op.Multishot = nullptr;
+    op.Type = 0;
+    ++op.Gen;
+    free_ops_.push_back(id);
+}
+
+io_uring_sqe* TUring::PrepareOp(int opcode, int fd, uint8_t kind, THandle h, int* result,
+                                TUringMultishot* ms, int type) {
+    auto id = AllocOp(fd);
+    auto& op = ops_[id];
+    op.Handle = h;
+    op.Result = result;
+    op.Multishot = ms;
+    op.Kind = kind;
+    op.Opcode = opcode;
+    op.Type = type;
+    auto* sqe = GetSqe();
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = (static_cast<uint64_t>(op.Gen) << 32) | id;
+    return sqe;
+}
+
+io_uring_sqe* TUring::PrepareTimedOp(int opcode, int fd, THandle h, int* result,
+                                     TTime deadline) {
+    // the request and its linked timeout go to the kernel in the same submission
+    Reserve(deadline != TTime::max() ? 2 : 1);
+    return PrepareOp(opcode, fd, OP, h, result);
+}
+
+void TUring::CancelOp(uint32_t id) {
+    auto& op = ops_[id];
+    uint64_t user_data = (static_cast<uint64_t>(op.Gen) << 32) | id;
+    Unlink(id);
+    op.Handle = {};
+    op.Result = nullptr;
+    op.Multishot = nullptr;
+    auto* sqe = GetSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = ignored_user_data;
+}
+
+void TUring::Cancel(int fd) {
+    if (fd < 0 || static_cast<int>(fd_ops_.size()) <= fd) {
+        return;
+    }
+    while (auto id = fd_ops_[fd]) {
+        CancelOp(id);
+    }
+}
+
+void TUring::Read(int fd, void* buf, int size, THandle h, int* result) {
+    auto* sqe = PrepareOp(IORING_OP_READ, fd, OP, h, result);
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = size;
+    sqe->off = static_cast<uint64_t>(-1);
+}
+
+void TUring::Write(int fd, const void* buf, int size, THandle h, int* result) {
+    auto* sqe = PrepareOp(IORING_OP_WRITE, fd, OP, h, result);
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = size;
+    sqe->off = static_cast<uint64_t>(-1);
+}
+
+void TUring::Recv(int fd, void* buf, int size, THandle h, int* result, TTime deadline) {
+    auto* sqe = PrepareTimedOp(IORING_OP_RECV, fd, h, result, deadline);
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = size;
+    LinkTimeout(sqe, deadline);
+}
+
+void TUring::Send(int fd, const void* buf, int size, THandle h, int* result, TTime deadline) {
+    auto* sqe = PrepareTimedOp(IORING_OP_SEND, fd, h, result, deadline);
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = size;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    LinkTimeout(sqe, deadline);
+}
+
+void TUring::RecvMsg(int fd, msghdr* msg, THandle h, int* result, TTime deadline) {
+    auto* sqe = PrepareTimedOp(IORING_OP_RECVMSG, fd, h, result, deadline);
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    LinkTimeout(sqe, deadline);
+}
+
+void TUring::SendMsg(int fd, const msghdr* msg, THandle h, int* result, TTime deadline) {
+    auto* sqe = PrepareTimedOp(IORING_OP_SENDMSG, fd, h, result, deadline);
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    LinkTimeout(sqe, deadline);
+}
+
+void TUring::Accept(int fd, sockaddr* addr, socklen_t* len, THandle h, int* result,
+                    TTime deadline) {
+    auto* sqe = PrepareTimedOp(IORING_OP_ACCEPT, fd, h, result, deadline);
+    sqe->addr = reinterpret_cast<uint64_t>(addr);
+    sqe->addr2 = reinterpret_cast<uint64_t>(len);
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    LinkTimeout(sqe, deadline);
+}
+
+void TUring::Connect(int fd, const sockaddr* addr, socklen_t len, THandle h, int* result,
+                     TTime deadline) {
+    auto* sqe = PrepareTimedOp(IORING_OP_CONNECT, fd, h, result, deadline);
+    sqe->addr = reinterpret_cast<uint64_t>(addr);
+    sqe->off = len;
+    LinkTimeout(sqe, deadline);
+}
+
+void TUring::LinkTimeout(io_uring_sqe* sqe, TTime deadline) {
+    if (deadline != TTime::max()) {
+        // the kernel cancels the request with -ECANCELED once the linked timeout expires
+        sqe->flags |= IOSQE_IO_LINK;
+        // room reserved by PrepareTimedOp(): no Submit() between the two SQEs
+        auto* timeout = GetSqe();
+        auto since_epoch = deadline.time_since_epoch();
+        auto sec = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+        auto& ts = link_timeouts_.emplace_back();
+        ts.tv_sec = sec.count();
+        ts.tv_nsec =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - sec).count();
+        timeout->opcode = IORING_OP_LINK_TIMEOUT;
+        timeout->fd = -1;
+        timeout->addr = reinterpret_cast<uint64_t>(&ts);
+        timeout->len = 1;
+        timeout->timeout_flags = IORING_TIMEOUT_ABS;
+        timeout->user_data = ignored_user_data;
+    }
+}
+
+void TUring::AcceptMultishot(int fd, TUringMultishot* state) {
+    auto* sqe = PrepareOp(IORING_OP_ACCEPT, fd, MULTISHOT, {}, nullptr, state);
+    sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+}
+
+void TUring::RecvMultishot(int fd, uint16_t groupId, TUringMultishot* state) {
+    auto* sqe = PrepareOp(IORING_OP_RECV, fd, MULTISHOT, {}, nullptr, state);
+    ops_[sqe->user_data & 0xffffffff].Group = groupId;
+    sqe->ioprio |= IORING_RECV_MULTISHOT;
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = groupId;
+}
+
+void TUring::ApplyChanges() {
+    for (const auto& ch : changes_) {
+        for (int type : {TEvent::READ, TEvent::WRITE, TEvent::RHUP, TEvent::ERR}) {
+            if (!(ch.Type & type)) {
+                continue;
+            }
+            uint32_t found = 0;
+            if (ch.Fd < static_cast<int>(fd_ops_.size())) {
+                for (auto id = fd_ops_[ch.Fd]; id; id = ops_[id].Next) {
+                    if (ops_[id].Kind == POLL && ops_[id].Type == type) {
+                        found = id;
+                        break;
+                    }
+                }
+            }
+            if (ch.Handle) {
+                if (found) {
+                    ops_[found].Handle = ch.Handle;
+                } else {
+                    auto* sqe = PrepareOp(IORING_OP_POLL_ADD, ch.Fd, POLL, ch.Handle, nullptr,
+                                          nullptr, type);
+                    sqe->poll32_events = type == TEvent::READ    ? POLLIN
+                                         : type == TEvent::WRITE ? POLLOUT
+                                         : type == TEvent::RHUP  ? POLLRDHUP
+                                                                 : POLLERR;
+                }
+            } else if (found) {
+                CancelOp(found);
+            }
+        }
+    }
+}
+
+void TUring::Complete(uint64_t userData, int res, unsigned flags) {
+    TN_TRACE(trace_, Debug, UringComplete, userData, res, flags);
+    if (userData == ignored_user_data) {
+        return;
+    }
+    if (userData == wake_user_data) {
+        wake_armed_ = false;
+        return;
+    }
+    uint32_t id = static_cast<uint32_t>(userData);
+    uint32_t gen = static_cast<uint32_t>(userData >> 32);
+    if (id >= ops_.size() || ops_[id].Gen != gen) {
+        return;
+    }
+    auto& op = ops_[id];
+    bool more = flags & IORING_CQE_F_MORE;
+    switch (op.Opcode) {
+        case IORING_OP_RECV:
+        case IORING_OP_RECVMSG:
+            metrics_.CountRead(res);
+            break;
+        case IORING_OP_SEND:
+        case IORING_OP_SENDMSG:
+            metrics_.CountWrite(res);
+            break;
+    }
+
+    if (op.Kind == MULTISHOT) {
+        if (auto* state = op.Multishot) {
+            state->Completions.push_back({res, flags});
+            if (!more) {
+                state->Armed = false;
+            }
+            if (state->Waiter) {
+                ready_events_.emplace_back(TEvent{-1, TEvent::READ, state->Waiter});
+                state->Waiter = {};
+            }
+        } else {
+            Drop(op, res, flags);
+        }
+        if (!more) {
+            FreeOp(id);
+        }
+        return;
+    }
+
+    if (op.Handle) {
+        if (op.Result) {
+            *op.Result = res;
+        }
+        // Fd is -1: the request is one-shot, there is nothing to disarm after the wakeup
+        ready_events_.emplace_back(TEvent{-1, op.Type ? op.Type : TEvent::READ, op.Handle});
+    } else {
+        Drop(op, res, flags);
+    }
+    FreeOp(id);
+}
+
+void TUring::Drop(const TOp& op, int res, unsigned flags) {
+    // results nobody waits for anymore must not leak descriptors or provided buffers
+    if (op.Opcode == IORING_OP_ACCEPT && res >= 0) {
+        close(res);
+    }
+    if (flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        for (auto* ring : buffer_rings_) {
+            if (ring->GroupId() == op.Group) {
+                ring->Recycle(bid);
+            }
+        }
+    }
+}
+
+void TUring::Reap() {
+    unsigned head = *cq_head_;
+    unsigned tail = load_acquire(*cq_tail_);
+    unsigned mask = *cq_mask_;
+    metrics_.EventsPerPoll.Record(tail - head);
+    for (; head != tail; ++head) {
+        const auto& cqe = cqes_[head & mask];
+        Complete(cqe.user_data, cqe.res, cqe.flags);
+    }
+    store_release(*cq_head_, head);
+}
+
+void TUring::Poll() {
+    metrics_.ChangesPerPoll.Record(changes_.size());
+    ApplyChanges();
+    Reset();
+    if (!wake_armed_) {
+        // a read of the eventfd completes when another thread calls Wake()
+        auto* sqe = GetSqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = wake_fd_;
+        sqe->addr = reinterpret_cast<uint64_t>(&wake_value_);
+        sqe->len = sizeof(wake_value_);
+        sqe->user_data = wake_user_data;
+        wake_armed_ = true;
+    }
+
+    auto waitStart = BeginWait();
+    auto ts = GetTimeout();
+    bool has_completions = *cq_head_ != load_acquire(*cq_tail_);
+    bool wait = !has_completions && (ts.tv_sec != 0 || ts.tv_nsec != 0);
+    bool spun = false;
+    if (wait && BusyPolling()) {
+        // the kernel works on the submitted requests while we watch the completion queue
+        Submit();
+        spun = true;
+        has_completions =
+            Spin([this] { return *cq_head_ != load_acquire(*cq_tail_) ? 1 : 0; }) > 0;
+        ts = GetTimeout();  // the spin may have run up to a timer deadline
+        wait = !has_completions && (ts.tv_sec != 0 || ts.tv_nsec != 0);
+    }
+    timeout_ts_.tv_sec = ts.tv_sec;
+    timeout_ts_.tv_nsec = ts.tv_nsec;
+
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    void* arg = nullptr;
+    size_t argsz = 0;
+    io_uring_getevents_arg ext = {};
+    if (wait) {
+        if (ext_arg_) {
+            ext.ts = reinterpret_cast<uint64_t>(&timeout_ts_);
+            flags |= IORING_ENTER_EXT_ARG;
+            arg = &ext;
+            argsz = sizeof(ext);
+        } else {
+            // kernels before 5.11: a timeout request that also completes on the first CQE
+            auto* sqe = GetSqe();
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(&timeout_ts_);
+            sqe->len = 1;
+            sqe->off = 1;
+            sqe->user_data = ignored_user_data;
+        }
+    }
+
+    store_release(*sq_tail_, sq_local_tail_);
+    int ret = uring_enter(fd_, to_submit_, wait ? 1 : 0, flags, arg, argsz);
+    if (spun && wait) {
+        AdaptBusyPoll(TClock::now() - waitStart, *cq_head_ != load_acquire(*cq_tail_));
+    }
+    EndWait(waitStart);
+    if (ret < 0) {
+        if (!(errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+            throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+        }
+    } else {
+        TN_TRACE(trace_, Debug, UringSubmit, ret);
+        metrics_.UringSubmitted.Add(ret);
+        to_submit_ -= std::min<unsigned>(ret, to_submit_);
+    }
+    if (to_submit_ == 0) {
+        link_timeouts_.clear();
+    }
+
+    Reap();
+    ProcessRemote();
+    ProcessTimers();
+    metrics_.ReadyPerPoll.Record(ready_events_.size());
+}
+
+TUringBufferRing::TUringBufferRing(TUring& uring, uint16_t groupId, uint32_t entries,
+                                   uint32_t bufferSize)
+    : uring_(uring), group_id_(groupId), entries_(entries), buffer_size_(bufferSize) {
+    if (entries == 0 || entries > 32768 || (entries & (entries - 1)) != 0) {
+        throw std::invalid_argument("Buffer ring size must be a power of 2 not above 32768");
+    }
+    ring_size_ = entries * sizeof(io_uring_buf);
+    void* p = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (p == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    ring_ = static_cast<io_uring_buf_ring*>(p);
+
+    io_uring_buf_reg reg = {};
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring_);
+    reg.ring_entries = entries;
+    reg.bgid = groupId;
+    if (uring_register(uring_.Fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int err = errno;
+        munmap(ring_, ring_size_);
+        throw std::system_error(err, std::generic_category(), "IORING_REGISTER_PBUF_RING");
+    }
+
+    data_.reset(new char[static_cast<size_t>(entries) * bufferSize]);
+    for (uint32_t i = 0; i < entries; ++i) {
+        Recycle(static_cast<uint16_t>(i));
+    }
+    uring_.buffer_rings_.push_back(this);
+}
+
+TUringBufferRing::~TUringBufferRing() {
+    auto& rings = uring_.buffer_rings_;
+    rings.erase(std::remove(rings.begin(), rings.end(), this), rings.end());
+    io_uring_buf_reg reg = {};
+    reg.bgid = group_id_;
+    uring_register(uring_.Fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    munmap(ring_, ring_size_);
+}
+
+void TUringBufferRing::Recycle(uint16_t id) {
+    // not ring_->bufs: in C++ the flexible array is shifted by the empty struct
+    // emitted by __DECLARE_FLEX_ARRAY
+    auto& buf = reinterpret_cast<io_uring_buf*>(ring_)[tail_ & (entries_ - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(data_.get() + static_cast<size_t>(id) * buffer_size_);
+    buf.len = buffer_size_;
+    buf.bid = id;
+    ++tail_;
+    store_release(ring_->tail, tail_);
+}
+
+}  // namespace NNet
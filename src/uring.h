@@ -0,0 +1,482 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include "base.h"
+#include "poller.h"
+#include "socket.h"
+
+namespace NNet {
+class TUringSocket;
+class TUringBufferRing;
+class TFileHandle;
+
+/**
+ * @brief Completions of a multishot request (accept or recv) that are not consumed yet.
+ *
+ * One SQE keeps producing CQEs until the kernel drops the IORING_CQE_F_MORE flag,
+ * so the results are queued here and handed out one per co_await.
+ */
+struct TUringMultishot {
+    struct TCompletion {
+        int Result;
+        unsigned Flags;
+    };
+
+    std::deque<TCompletion> Completions;  // results not consumed by the owner yet
+    THandle Waiter;                       // coroutine waiting for the next completion
+    bool Armed = false;                   // request is still active in the kernel
+};
+
+class TUring : public TPollerBase {
+ public:
+    using TSocket = NNet::TUringSocket;
+    using TFileHandle = NNet::TFileHandle;
+
+    TUring(unsigned queueSize = 256);
+    ~TUring();
+
+    /**
+     * @brief Operations submitted as SQEs.
+     *
+     * The coroutine @p h is resumed once the matching CQE is reaped, the value of
+     * cqe->res (bytes, new descriptor or -errno) is stored into @p result before that.
+     */
+    void Read(int fd, void* buf, int size, THandle h, int* result);
+    void Write(int fd, const void* buf, int size, THandle h, int* result);
+    void Recv(int fd, void* buf, int size, THandle h, int* result, TTime deadline = TTime::max());
+    void Send(int fd, const void* buf, int size, THandle h, int* result,
+              TTime deadline = TTime::max());
+    void RecvMsg(int fd, msghdr* msg, THandle h, int* result, TTime deadline = TTime::max());
+    void SendMsg(int fd, const msghdr* msg, THandle h, int* result,
+                 TTime deadline = TTime::max());
+    void Accept(int fd, sockaddr* addr, socklen_t* len, THandle h, int* result,
+                TTime deadline = TTime::max());
+    void Connect(int fd, const sockaddr* addr, socklen_t len, THandle h, int* result,
+                 TTime deadline = TTime::max());
+
+    /**
+     * @brief Multishot operations, every CQE is queued into @p state.
+     *
+     * RecvMultishot requires a buffer ring registered with @p groupId (see TUringBufferRing).
+     */
+    void AcceptMultishot(int fd, TUringMultishot* state);
+    void RecvMultishot(int fd, uint16_t groupId, TUringMultishot* state);
+
+    /**
+     * @brief Detaches every pending operation on @p fd and asks the kernel to cancel it.
+     *
+     * The CQEs of detached operations are dropped, so nothing is resumed after this call.
+     */
+    void Cancel(int fd);
+
+    void Submit();
+    void Poll();
+
+    int Fd() const { return fd_; }
+
+ private:
+    enum EOpKind : uint8_t { OP = 0, POLL = 1, MULTISHOT = 2 };
+
+    struct TOp {
+        THandle Handle;
+        int* Result = nullptr;
+        TUringMultishot* Multishot = nullptr;
+        int Fd = -1;
+        int Type = 0;  // TEvent type for POLL operations
+        uint8_t Kind = OP;
+        uint8_t Opcode = 0;
+        uint16_t Group = 0;  // provided buffer group of a multishot recv
+        uint32_t Gen = 1;
+        uint32_t Prev = 0;  // neighbours in the per-fd list
+        uint32_t Next = 0;
+    };
+
+    void Release();
+    void Reserve(unsigned count);  // submits if fewer than count SQEs are free
+    io_uring_sqe* GetSqe();
+    void LinkTimeout(io_uring_sqe* sqe, TTime deadline);  // links an absolute timeout to sqe
+    io_uring_sqe* PrepareOp(int opcode, int fd, uint8_t kind, THandle h, int* result,
+                            TUringMultishot* ms = nullptr, int type = 0);
+    // PrepareOp() with room for the LinkTimeout() of deadline
+    io_uring_sqe* PrepareTimedOp(int opcode, int fd, THandle h, int* result, TTime deadline);
+    uint32_t AllocOp(int fd);
+    void Unlink(uint32_t id);
+    void FreeOp(uint32_t id);
+    void CancelOp(uint32_t id);
+    void ApplyChanges();
+    void Reap();
+    void Complete(uint64_t userData, int res, unsigned flags);
+    void Drop(const TOp& op, int res, unsigned flags);
+
+    friend class TUringBufferRing;
+
+    int fd_ = -1;
+    bool ext_arg_ = false;
+
+    // submission queue
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_entries_ = 0;
+    unsigned sq_local_tail_ = 0;
+    unsigned to_submit_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+
+    // completion queue
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    size_t sqes_size_ = 0;
+
+    std::vector<TOp> ops_;             // slot 0 is a sentinel, id == index
+    std::vector<uint32_t> free_ops_;   // released slots
+    std::vector<uint32_t> fd_ops_;     // head of the list of pending operations per fd
+    std::vector<TUringBufferRing*> buffer_rings_;     // registered provided buffer rings
+    std::deque<__kernel_timespec> link_timeouts_;     // deadlines of not yet submitted requests
+    __kernel_timespec timeout_ts_ = {};
+    uint64_t wake_value_ = 0;  // target of the pending read of the wake eventfd
+    bool wake_armed_ = false;
+};
+
+/**
+ * @brief A buffer ring shared with the kernel (IORING_REGISTER_PBUF_RING).
+ *
+ * Multishot receives pick buffers from it, so no memory is pinned by idle connections.
+ * The buffer is handed back to the kernel with Recycle().
+ */
+class TUringBufferRing {
+ public:
+    TUringBufferRing(TUring& uring, uint16_t groupId, uint32_t entries = 256,
+                     uint32_t bufferSize = 4096);
+    ~TUringBufferRing();
+
+    TUringBufferRing(const TUringBufferRing&) = delete;
+    TUringBufferRing& operator=(const TUringBufferRing&) = delete;
+
+    uint16_t GroupId() const { return group_id_; }
+
+    std::span<char> Buffer(uint16_t id, size_t size) {
+        return {data_.get() + static_cast<size_t>(id) * buffer_size_, size};
+    }
+
+    void Recycle(uint16_t id);
+
+ private:
+    TUring& uring_;
+    uint16_t group_id_;
+    uint32_t entries_;
+    uint32_t buffer_size_;
+    io_uring_buf_ring* ring_ = nullptr;
+    size_t ring_size_ = 0;
+    uint16_t tail_ = 0;
+    std::unique_ptr<char[]> data_;
+};
+
+/**
+ * @brief A buffer received by a multishot recv, returned to its ring on destruction.
+ */
+class TUringBuffer {
+ public:
+    TUringBuffer() = default;
+    TUringBuffer(TUringBufferRing* ring, uint16_t id, int size)
+        : ring_(ring), id_(id), size_(size) {}
+    TUringBuffer(TUringBuffer&& other) { *this = std::move(other); }
+    TUringBuffer& operator=(TUringBuffer&& other) {
+        if (this != &other) {
+            Release();
+            ring_ = other.ring_;
+            id_ = other.id_;
+            size_ = other.size_;
+            other.ring_ = nullptr;
+        }
+        return *this;
+    }
+    ~TUringBuffer() { Release(); }
+
+    int Size() const { return size_; }
+
+    std::span<char> Data() { return ring_ ? ring_->Buffer(id_, size_) : std::span<char>{}; }
+
+    void Release() {
+        if (ring_) {
+            ring_->Recycle(id_);
+            ring_ = nullptr;
+        }
+    }
+
+ private:
+    TUringBufferRing* ring_ = nullptr;
+    uint16_t id_ = 0;
+    int size_ = 0;
+};
+
+class TUringSocket : public TSocket {
+ public:
+    using TPoller = TUring;
+
+    TUringSocket() = default;
+
+    TUringSocket(TUring& poller, int domain, int type = SOCK_STREAM)
+        : TSocket(poller, domain, type) {}
+
+    TUringSocket(const TAddress& addr, int fd, TUring& poller) : TSocket(addr, fd, poller) {}
+
+    TUringSocket(int fd, TUring& poller) : TSocket(fd, poller) {}
+
+    TUringSocket(const TAddress& addr, int fd, TUring& poller, TNoSetup tag)
+        : TSocket(addr, fd, poller, tag) {}
+
+    TUringSocket(int fd, TUring& poller, TNoSetup tag) : TSocket(fd, poller, tag) {}
+
+    TUringSocket(TUringSocket&& other) { *this = std::move(other); }
+
+    TUringSocket& operator=(TUringSocket&& other) {
+        if (this != &other) {
+            Close();
+            TSocket::operator=(std::move(other));
+            accept_ms_ = std::move(other.accept_ms_);
+            recv_ms_ = std::move(other.recv_ms_);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Operations bounded by @p deadline throw TTimeoutError once it passes, the
+     * kernel cancels the request with a linked timeout.
+     */
+    auto ReadSome(void* buf, size_t size, TTime deadline = TTime::max()) {
+        struct TAwaitableRead : TUringAwaitable {
+            void await_suspend(std::coroutine_handle<> h) {
+                this->Uring()->Recv(this->fd, this->b, this->s, h, &this->ret, this->deadline);
+            }
+        };
+        return TAwaitableRead{{poller_, fd_, buf, size, -1, deadline}};
+    }
+
+    auto WriteSome(const void* buf, size_t size, TTime deadline = TTime::max()) {
+        struct TAwaitableWrite : TUringAwaitable {
+            void await_suspend(std::coroutine_handle<> h) {
+                this->Uring()->Send(this->fd, this->b, this->s, h, &this->ret, this->deadline);
+            }
+        };
+        return TAwaitableWrite{{poller_, fd_, const_cast<void*>(buf), size, -1, deadline}};
+    }
+
+    auto ReadSomeV(std::span<const iovec> iov, TTime deadline = TTime::max()) {
+        struct TAwaitableRead : TUringAwaitable {
+            void await_suspend(std::coroutine_handle<> h) {
+                this->Uring()->RecvMsg(this->fd, &msg, h, &this->ret, this->deadline);
+            }
+
+            msghdr msg;
+        };
+        return TAwaitableRead{{poller_, fd_, nullptr, 0, -1, deadline}, MakeMsg(iov)};
+    }
+
+    auto WriteSomeV(std::span<const iovec> iov, TTime deadline = TTime::max()) {
+        struct TAwaitableWrite : TUringAwaitable {
+            void await_suspend(std::coroutine_handle<> h) {
+                this->Uring()->SendMsg(this->fd, &msg, h, &this->ret, this->deadline);
+            }
+
+            msghdr msg;
+        };
+        return TAwaitableWrite{{poller_, fd_, nullptr, 0, -1, deadline}, MakeMsg(iov)};
+    }
+
+    auto Connect(const TAddress& addr, TTime deadline = TTime::max()) {
+        if (remote_addr_.has_value()) {
+            throw std::runtime_error("Already connected");
+        }
+        remote_addr_ = addr;
+        struct TAwaitableConnect : TUringAwaitable {
+            void await_suspend(std::coroutine_handle<> h) {
+                this->Uring()->Connect(this->fd, addr.first, addr.second, h, &this->ret,
+                                       this->deadline);
+            }
+
+            void await_resume() { TUringAwaitable::await_resume(); }
+
+            std::pair<const sockaddr*, int> addr;
+        };
+        return TAwaitableConnect{{poller_, fd_, nullptr, 0, -1, deadline},
+                                 remote_addr_->RawAddr()};
+    }
+
+    auto Accept(TTime deadline = TTime::max()) {
+        struct TAwaitableAccept : TUringAwaitable {
+            void await_suspend(std::coroutine_handle<> h) {
+                this->Uring()->Accept(this->fd, reinterpret_cast<sockaddr*>(&addr), &len, h,
+                                      &this->ret, this->deadline);
+            }
+
+            TUringSocket await_resume() {
+                int clientfd = TUringAwaitable::await_resume();
+                return TUringSocket{TAddress{reinterpret_cast<sockaddr*>(&addr), len}, clientfd,
+                                    *this->Uring(), TNoSetup{}};
+            }
+
+            sockaddr_storage addr = {};
+            socklen_t len = sizeof(sockaddr_in6);
+        };
+        return TAwaitableAccept{{poller_, fd_, nullptr, 0, -1, deadline}};
+    }
+
+    /**
+     * @brief TSocket::AcceptBatch() for io_uring sockets: waits for readiness, then accept4().
+     */
+    template <typename TFunc>
+    TValueTask<size_t> AcceptBatch(TFunc onAccept, size_t max = 64,
+                                   TTime deadline = TTime::max()) {
+        return TSocket::AcceptBatch<TUringSocket>(poller_, fd_, std::move(onAccept), max,
+                                                  deadline);
+    }
+
+    /**
+     * @brief Accepts with a single multishot SQE armed on the first call.
+     *
+     * Peer addresses are not reported by multishot accept, RemoteAddr() stays empty.
+     */
+    auto AcceptMultishot() {
+        if (!accept_ms_) {
+            accept_ms_ = std::make_unique<TUringMultishot>();
+        }
+        struct TAwaitableAccept : TMultishotAwaitable<TAwaitableAccept> {
+            void Arm() { this->Uring()->AcceptMultishot(this->fd, this->state); }
+
+            TUringSocket await_resume() {
+                auto c = this->Pop();
+                return TUringSocket{c.Result, *this->Uring(), TNoSetup{}};
+            }
+        };
+        return TAwaitableAccept{{poller_, fd_, accept_ms_.get()}};
+    }
+
+    /**
+     * @brief Receives into buffers picked by the kernel from @p ring.
+     *
+     * The returned buffer must be released (or destroyed) to give it back to the ring,
+     * Size() == 0 means the peer closed the connection.
+     */
+    auto ReadSomeMultishot(TUringBufferRing& ring) {
+        if (!recv_ms_) {
+            recv_ms_ = std::make_unique<TUringMultishot>();
+        }
+        struct TAwaitableRecv : TMultishotAwaitable<TAwaitableRecv> {
+            void Arm() { this->Uring()->RecvMultishot(this->fd, ring->GroupId(), this->state); }
+
+            bool await_ready() {
+                // the ring was exhausted, wait for the owner to recycle buffers and rearm
+                if (!this->state->Completions.empty() &&
+                    this->state->Completions.front().Result == -ENOBUFS) {
+                    this->state->Completions.pop_front();
+                }
+                return TMultishotAwaitable<TAwaitableRecv>::await_ready();
+            }
+
+            TUringBuffer await_resume() {
+                auto c = this->Pop();
+                if (!(c.Flags & IORING_CQE_F_BUFFER)) {
+                    return TUringBuffer{};
+                }
+                return TUringBuffer{ring, static_cast<uint16_t>(c.Flags >> IORING_CQE_BUFFER_SHIFT),
+                                    c.Result};
+            }
+
+            TUringBufferRing* ring;
+        };
+        return TAwaitableRecv{{poller_, fd_, recv_ms_.get()}, &ring};
+    }
+
+    void Close() {
+        if (fd_ >= 0) {
+            static_cast<TUring*>(poller_)->Cancel(fd_);
+        }
+        TSocket::Close();
+    }
+
+ private:
+    struct TUringAwaitable {
+        bool await_ready() { return false; }
+
+        int await_resume() {
+            if (ret == -ECANCELED && deadline != TTime::max()) {
+                throw TTimeoutError("Socket operation timeout");
+            }
+            if (ret < 0) {
+                throw std::system_error(-ret, std::generic_category(), "Socket operation failed");
+            }
+            return ret;
+        }
+
+        TUring* Uring() { return static_cast<TUring*>(poller); }
+
+        TPollerBase* poller = nullptr;
+        int fd = -1;
+        void* b = nullptr;
+        size_t s = 0;
+        int ret = -1;
+        TTime deadline = TTime::max();  // cancelled by a linked timeout
+    };
+
+    static msghdr MakeMsg(std::span<const iovec> iov) {
+        msghdr msg = {};
+        msg.msg_iov = const_cast<iovec*>(iov.data());
+        msg.msg_iovlen = std::min<size_t>(iov.size(), IOV_MAX);
+        return msg;
+    }
+
+    template <typename T>
+    struct TMultishotAwaitable {
+        bool await_ready() { return !state->Completions.empty(); }
+
+        void await_suspend(std::coroutine_handle<> h) {
+            state->Waiter = h;
+            if (!state->Armed) {
+                state->Armed = true;
+                ((T*)this)->Arm();
+            }
+        }
+
+        TUringMultishot::TCompletion Pop() {
+            auto c = state->Completions.front();
+            state->Completions.pop_front();
+            if (c.Result < 0) {
+                throw std::system_error(-c.Result, std::generic_category(),
+                                        "Socket operation failed");
+            }
+            return c;
+        }
+
+        TUring* Uring() { return static_cast<TUring*>(poller); }
+
+        TPollerBase* poller = nullptr;
+        int fd = -1;
+        TUringMultishot* state = nullptr;
+    };
+
+    std::unique_ptr<TUringMultishot> accept_ms_;
+    std::unique_ptr<TUringMultishot> recv_ms_;
+};
+
+}  // namespace NNet
@@ -0,0 +1,241 @@
+#include "watchdog.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "poller.h"
+
+namespace NNet {
+
+namespace {
+
+const char* SourceName(EStallSource source) {
+    switch (source) {
+        case EStallSource::None:
+            return "no resume";
+        case EStallSource::Event:
+            return "event";
+        case EStallSource::Timer:
+            return "timer";
+        case EStallSource::Posted:
+            return "posted callable";
+    }
+    return "unknown";
+}
+
+std::string EventTypeName(int type) {
+    std::string name;
+    for (auto [bit, text] : {std::pair{TEvent::READ, "READ"}, std::pair{TEvent::WRITE, "WRITE"},
+                             std::pair{TEvent::RHUP, "RHUP"}, std::pair{TEvent::ERR, "ERR"}}) {
+        if (type & bit) {
+            name += name.empty() ? text : std::string("|") + text;
+        }
+    }
+    return name.empty() ? "NONE" : name;
+}
+
+// demangled symbol of @p address, or the module and offset for addr2line
+std::string Symbolize(const void* address) {
+    Dl_info info;
+    if (!address || !dladdr(address, &info)) {
+        return {};
+    }
+    if (info.dli_sname) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string symbol = status == 0 ? demangled : info.dli_sname;
+        free(demangled);
+        return symbol;
+    }
+    char offset[32];
+    snprintf(offset, sizeof(offset), "+0x%zx",
+             static_cast<const char*>(address) - static_cast<const char*>(info.dli_fbase));
+    return std::string(info.dli_fname ? info.dli_fname : "?") + offset;
+}
+
+}  // namespace
+
+std::string TStallReport::ToString() const {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.3fms", Elapsed.count() / 1e6);
+    std::string text = "loop '" + Loop + "' " + (Step ? "step" : "resume") + " has taken " + buf +
+                       (Finished ? "" : " and is still running");
+    if (Source != EStallSource::None) {
+        text += Step ? ", running " : ", ";
+        text += SourceName(Source);
+        if (Source == EStallSource::Event) {
+            text += " " + EventTypeName(EventType) +
+                    (Fd >= 0 ? " on fd " + std::to_string(Fd) : " (cross-thread or io_uring)");
+        } else if (Source == EStallSource::Timer) {
+            text += " " + std::to_string(TimerId);
+        }
+        snprintf(buf, sizeof(buf), " %p", Frame);
+        text += buf;
+        if (!Symbol.empty()) {
+            text += " " + Symbol;
+        }
+    }
+    if (Suppressed) {
+        text += " (" + std::to_string(Suppressed) + " reports suppressed)";
+    }
+    return text;
+}
+
+void TStallProbe::StepFinished(int64_t since, int64_t elapsed) {
+    if (reported_busy_.exchange(since) == since) {
+        return;  // the watchdog has seen it running
+    }
+    TStallReport report;
+    report.Step = true;
+    report.Finished = true;
+    report.Elapsed = std::chrono::nanoseconds(elapsed);
+    Queue(std::move(report));
+}
+
+void TStallProbe::ResumeFinished(int64_t elapsed) {
+    auto seq = seq_.load(std::memory_order_relaxed);
+    // the step of a slow resume is slow too, one report is enough
+    reported_busy_.store(busy_since_.load(std::memory_order_relaxed));
+    if (reported_seq_.exchange(seq) == seq) {
+        return;
+    }
+    TStallReport report;
+    report.Finished = true;
+    report.Elapsed = std::chrono::nanoseconds(elapsed);
+    report.Source = source_.load(std::memory_order_relaxed);
+    report.Fd = fd_.load(std::memory_order_relaxed);
+    report.EventType = type_.load(std::memory_order_relaxed);
+    report.TimerId = timer_id_.load(std::memory_order_relaxed);
+    report.Frame = frame_.load(std::memory_order_relaxed);
+    report.Function = function_.load(std::memory_order_relaxed);
+    Queue(std::move(report));
+}
+
+bool TStallProbe::ReadResume(TStallReport* report, uint64_t* serial, int64_t* start) const {
+    auto seq = seq_.load(std::memory_order_acquire);
+    if (seq & 1) {
+        return false;
+    }
+    report->Source = source_.load(std::memory_order_relaxed);
+    report->Fd = fd_.load(std::memory_order_relaxed);
+    report->EventType = type_.load(std::memory_order_relaxed);
+    report->TimerId = timer_id_.load(std::memory_order_relaxed);
+    report->Frame = frame_.load(std::memory_order_relaxed);
+    report->Function = function_.load(std::memory_order_relaxed);
+    *start = start_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    *serial = seq;
+    return seq_.load(std::memory_order_relaxed) == seq;
+}
+
+void TStallProbe::Queue(TStallReport report) {
+    report.Loop = name_;
+    std::lock_guard lock(mutex_);
+    pending_.emplace_back(std::move(report));
+}
+
+TLoopWatchdog::TLoopWatchdog() : TLoopWatchdog(TOptions()) {}
+
+TLoopWatchdog::TLoopWatchdog(TOptions options) : options_(std::move(options)) {
+    if (!options_.OnStall) {
+        options_.OnStall = [](const TStallReport& report) {
+            std::cerr << "TinyNet stall: " << report.ToString() << "\n";
+        };
+    }
+    thread_ = std::thread([this] { Run(); });
+}
+
+TLoopWatchdog::~TLoopWatchdog() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    stop_cv_.notify_one();
+    thread_.join();
+}
+
+void TLoopWatchdog::Watch(TPollerBase& poller, std::string name) {
+    std::lock_guard lock(mutex_);
+    if (name.empty()) {
+        name = std::to_string(probes_.size());
+    }
+    auto probe = std::make_shared<TStallProbe>(std::move(name), options_.Threshold);
+    poller.SetStallProbe(probe);
+    probes_.emplace_back(std::move(probe));
+}
+
+void TLoopWatchdog::Unwatch(TPollerBase& poller) {
+    // the probe is dropped by the watchdog thread once the poller has let it go
+    poller.SetStallProbe(nullptr);
+}
+
+void TLoopWatchdog::Run() {
+    auto period = std::max<std::chrono::nanoseconds>(options_.Threshold / 4,
+                                                     std::chrono::milliseconds(1));
+    std::unique_lock lock(mutex_);
+    while (!stop_cv_.wait_for(lock, period, [this] { return stop_; })) {
+        auto now = TStallProbe::Ns(TClock::now());
+        for (auto it = probes_.begin(); it != probes_.end();) {
+            Check(**it, now);
+            if (it->use_count() == 1) {
+                it = probes_.erase(it);  // unwatched or its poller is gone
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void TLoopWatchdog::Check(TStallProbe& probe, int64_t now) {
+    std::vector<TStallReport> pending;
+    {
+        std::lock_guard lock(probe.mutex_);
+        pending.swap(probe.pending_);
+    }
+    for (auto& report : pending) {
+        Emit(std::move(report), now);
+    }
+
+    TStallReport report;
+    report.Loop = probe.name_;
+    uint64_t seq;
+    int64_t start;
+    if (!probe.ReadResume(&report, &seq, &start)) {
+        return;  // a resume is starting, look again on the next tick
+    }
+    if (start && now - start > probe.threshold_) {
+        probe.reported_busy_.store(probe.busy_since_.load(std::memory_order_relaxed));
+        if (probe.reported_seq_.exchange(seq) != seq) {
+            report.Elapsed = std::chrono::nanoseconds(now - start);
+            Emit(std::move(report), now);
+        }
+        return;
+    }
+    auto since = probe.busy_since_.load(std::memory_order_relaxed);
+    if (since && now - since > probe.threshold_ && probe.reported_busy_.exchange(since) != since) {
+        report.Step = true;
+        report.Elapsed = std::chrono::nanoseconds(now - since);
+        if (!start) {
+            report.Source = EStallSource::None;  // between resumes
+        }
+        Emit(std::move(report), now);
+    }
+}
+
+void TLoopWatchdog::Emit(TStallReport report, int64_t now) {
+    auto interval = std::chrono::nanoseconds(options_.ReportInterval).count();
+    if (last_report_ && now - last_report_ < interval) {
+        ++suppressed_;
+        return;
+    }
+    last_report_ = now;
+    report.Suppressed = suppressed_;
+    suppressed_ = 0;
+    report.Symbol = Symbolize(report.Function);
+    options_.OnStall(report);
+}
+
+}  // namespace NNet
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base.h"
+
+namespace NNet {
+
+class TPollerBase;
+
+/**
+ * @brief What the loop was running when it stalled.
+ */
+enum class EStallSource : uint8_t {
+    None,    // between resumes: epoll_ctl, timer bookkeeping, ...
+    Event,   // a coroutine woken by an fd event, by another thread or an io_uring completion
+    Timer,   // a coroutine woken by a timer
+    Posted,  // a callable passed to Post()
+};
+
+struct TStallReport {
+    std::string Loop;                   // name given to TLoopWatchdog::Watch()
+    bool Step = false;                  // the whole step is slow, not a single resume
+    bool Finished = false;              // false: reported while still running
+    std::chrono::nanoseconds Elapsed{0};
+    EStallSource Source = EStallSource::None;
+    int Fd = -1;                        // Event: -1 for cross-thread and io_uring wakeups
+    int EventType = 0;                  // Event: TEvent::READ, WRITE, ...
+    TTimerId TimerId = 0;               // Timer
+    const void* Frame = nullptr;        // coroutine frame or posted node
+    const void* Function = nullptr;     // its resume function
+    std::string Symbol;                 // of Function, or module+offset for addr2line
+    uint64_t Suppressed = 0;            // reports dropped by the rate limit before this one
+
+    std::string ToString() const;
+};
+
+/**
+ * @brief State of one loop shared with the watchdog thread.
+ *
+ * Written by the loop thread with relaxed stores under a sequence lock, nothing is
+ * written when a loop has no watchdog. Slow resumes and steps that finish before the
+ * watchdog thread notices them are queued by the loop thread itself.
+ */
+class TStallProbe {
+ public:
+    TStallProbe(std::string name, std::chrono::nanoseconds threshold)
+        : name_(std::move(name)), threshold_(threshold.count()) {}
+
+    // the loop is running since @p now: a step started or the wait returned
+    void Busy(TTime now) { busy_since_.store(Ns(now), std::memory_order_relaxed); }
+
+    // the loop is about to block or the step is over
+    void Idle(TTime now) {
+        auto since = busy_since_.load(std::memory_order_relaxed);
+        busy_since_.store(0, std::memory_order_relaxed);
+        if (since && Ns(now) - since > threshold_) {
+            StepFinished(since, Ns(now) - since);
+        }
+    }
+
+    void BeginResume(EStallSource source, int fd, int type, TTimerId timerId, const void* frame,
+                     const void* function) {
+        auto seq = seq_.load(std::memory_order_relaxed) + 1;
+        seq_.store(seq, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        source_.store(source, std::memory_order_relaxed);
+        fd_.store(fd, std::memory_order_relaxed);
+        type_.store(type, std::memory_order_relaxed);
+        timer_id_.store(timerId, std::memory_order_relaxed);
+        frame_.store(frame, std::memory_order_relaxed);
+        function_.store(function, std::memory_order_relaxed);
+        start_.store(Ns(TClock::now()), std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Resume of a coroutine: its resume function is the first word of the frame.
+     *
+     * This is the frame layout of GCC and Clang, the pointer is only used for the report.
+     */
+    void BeginResume(EStallSource source, int fd, int type, TTimerId timerId, THandle h) {
+        BeginResume(source, fd, type, timerId, h.address(), *static_cast<void**>(h.address()));
+    }
+
+    void EndResume() {
+        auto start = start_.load(std::memory_order_relaxed);
+        start_.store(0, std::memory_order_relaxed);
+        auto elapsed = Ns(TClock::now()) - start;
+        if (elapsed > threshold_) {
+            ResumeFinished(elapsed);
+        }
+    }
+
+ private:
+    friend class TLoopWatchdog;
+
+    static int64_t Ns(TTime t) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    }
+
+    // the slow paths, out of line
+    void StepFinished(int64_t since, int64_t elapsed);
+    void ResumeFinished(int64_t elapsed);
+    // a consistent copy of the current resume, false while it is being written
+    bool ReadResume(TStallReport* report, uint64_t* serial, int64_t* start) const;
+    void Queue(TStallReport report);
+
+    std::string name_;
+    int64_t threshold_;  // ns
+
+    std::atomic<int64_t> busy_since_ = 0;  // ns, 0 while blocked in the poller
+    std::atomic<uint64_t> seq_ = 0;        // odd while the resume fields are written
+    std::atomic<EStallSource> source_ = EStallSource::None;
+    std::atomic<int> fd_ = -1;
+    std::atomic<int> type_ = 0;
+    std::atomic<TTimerId> timer_id_ = 0;
+    std::atomic<const void*> frame_ = nullptr;
+    std::atomic<const void*> function_ = nullptr;
+    std::atomic<int64_t> start_ = 0;  // ns, 0 outside a resume
+
+    // whichever thread reports a stall first claims it
+    std::atomic<uint64_t> reported_seq_ = 0;
+    std::atomic<int64_t> reported_busy_ = 0;
+
+    std::mutex mutex_;
+    std::vector<TStallReport> pending_;  // found by the loop thread, emitted by the watchdog
+};
+
+/**
+ * @class TLoopWatchdog
+ * @brief Thread that reports loops blocked by a slow coroutine or a slow step.
+ *
+ * A resume or a step (without the time blocked in the poller) longer than the threshold
+ * is reported with the fd and event type or the timer id that caused it and the address
+ * and symbol of the coroutine. It is reported while still running, so a loop that never
+ * comes back is found too. Reports are rate limited and go to std::cerr by default.
+ *
+ * Example:
+ * @code
+ * TLoopWatchdog watchdog({.Threshold = std::chrono::milliseconds(50)});
+ * watchdog.Watch(loop.Poller(), "main");
+ * loop.Loop();
+ * @endcode
+ */
+class TLoopWatchdog {
+ public:
+    struct TOptions {
+        std::chrono::milliseconds Threshold{100};
+        std::chrono::milliseconds ReportInterval{1000};   // at most one report per interval
+        std::function<void(const TStallReport&)> OnStall;  // called on the watchdog thread
+    };
+
+    TLoopWatchdog();
+    explicit TLoopWatchdog(TOptions options);
+    ~TLoopWatchdog();
+
+    TLoopWatchdog(const TLoopWatchdog&) = delete;
+    TLoopWatchdog& operator=(const TLoopWatchdog&) = delete;
+
+    /**
+     * @brief Starts watching @p poller, before its loop runs or from its thread.
+     */
+    void Watch(TPollerBase& poller, std::string name = {});
+
+    /**
+     * @brief Stops watching @p poller, before its loop runs or from its thread.
+     */
+    void Unwatch(TPollerBase& poller);
+
+ private:
+    void Run();
+    void Check(TStallProbe& probe, int64_t now);
+    void Emit(TStallReport report, int64_t now);
+
+    TOptions options_;
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_ = false;
+    std::vector<std::shared_ptr<TStallProbe>> probes_;
+    int64_t last_report_ = 0;  // ns
+    uint64_t suppressed_ = 0;
+    std::thread thread_;
+};
+
+}  // namespace NNet
@@ -0,0 +1,51 @@
+#include "../src/trace.h"
+
+#include <fstream>
+#include <iostream>
+
+using NNet::ETraceEvent;
+using NNet::ETraceLevel;
+using NNet::TTraceRecord;
+using NNet::TTraceRing;
+
+// Prints a binary trace written by TTraceRing::Dump as text, one record per line:
+// <usec since the first record> <level> <event> <arg>=<value>...
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <trace file> [min level 0..3]\n";
+        return 1;
+    }
+    int min_level = argc > 2 ? atoi(argv[2]) : 0;
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << argv[1] << "\n";
+        return 1;
+    }
+
+    std::vector<TTraceRecord> records;
+    try {
+        records = TTraceRing::Load(in);
+    } catch (const std::exception& ex) {
+        std::cerr << "Cannot load trace: " << ex.what() << "\n";
+        return 1;
+    }
+
+    uint64_t start = records.empty() ? 0 : records.front().Time;
+    for (const auto& rec : records) {
+        if (rec.Level < min_level) {
+            continue;
+        }
+        const auto& info = NNet::GetTraceEventInfo(static_cast<ETraceEvent>(rec.Event));
+        std::cout << (rec.Time - start) / 1000.0 << " "
+                  << NNet::GetTraceLevelName(static_cast<ETraceLevel>(rec.Level)) << " "
+                  << info.Name;
+        for (int i = 0; i < 3; ++i) {
+            if (info.Args[i]) {
+                std::cout << " " << info.Args[i] << "=" << rec.Args[i];
+            }
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}